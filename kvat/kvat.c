@@ -8,6 +8,7 @@
  */
 
 #include "kvat/kvat.h"
+#include "kvat/kvat_frozen.h"
 
 #include <string.h>
 #include <driverlib/sysctl.h>
@@ -19,8 +20,24 @@
 //==========================================================
 // FORMATTING LIMITS
 
-#define FORMATID 214    // Persistence marker for formatting. Mismatch from storage will invalidate it.
+// CHANGELOG, MIGRATION and PAGESIZE can be given at build (-D). tools/Makefile builds older layouts that way for migrationcheck.
+
+#ifndef CHANGELOG
+#define CHANGELOG 1     // (bool) Keep a last-modified sequence per entry and tombstones of deleted keys (KVATChangesSince). Changes table layout.
+#endif
+#ifndef MIGRATION
+#define MIGRATION 1     // (bool) Migrate a store in a known older layout (knownFormats) instead of formatting it. Stages live data past the store.
+#endif
+
+#if CHANGELOG
+#define FORMATID 215    // Persistence marker for formatting. Mismatch from storage will migrate it (MIGRATION) or invalidate it.
+#else
+#define FORMATID 214    // Persistence marker for formatting. Mismatch from storage will migrate it (MIGRATION) or invalidate it.
+#endif
+#ifndef PAGESIZE
 #define PAGESIZE 12     // Size of a single page in bytes. Pages need to be a multiple of 4 bytes in size (256 max on single-byte-remains scheme)
+                        // Fixed at build: page operations take it as a constant. A store with another page size is migrated or formatted.
+#endif
 #define PAGECOUNT 128   // 255 max on a single-byte-paging scheme
 
 // NOTE: Current implementation scheme is single-byte-paging and single-byte-remains (usable storage on max: 65KB)
@@ -28,17 +45,21 @@
 //==========================================================
 // GENERAL LIMITS
 
-#define INDEXSTART 0    // Address that the index starts on in storage
+#define INDEXSTART 0        // Address that the index starts on in storage
+#define EEPROMBLOCKSIZE 64  // Size of a block of storage in bytes (16 words on TM4C EEPROM). Batched table programs are kept within this size.
+#define PAGECOUNTMAX 255    // Most pages a store can be resized to (KVATResize), on a single-byte-paging scheme
 
 //==========================================================
 // RECOMMENDED LIMITS
 
 #define STRINGKEYSTDLEN 16  // Expected maximum length for string-keys (baseline, not enforced)
+#define PREFIXCOUNTERMAX 4  // Maximum number of prefixes that can have their keys counted (KVATRegisterPrefixCounter)
+#define SUBSCRIPTIONMAX 4   // Maximum number of change subscriptions (KVATSubscribe)
 
 //==========================================================
 /* TABLE ENTRY METADATA FORMATTING
  *
- * x x KF KF  VT KT ST ST > lsb
+ * VF VF KF KF  VT KT ST ST > lsb
  *
  */
 
@@ -66,6 +87,13 @@
 //#define MKF_            0x20    // (undefined)
 //#define MKF_            0x30    // (undefined)
 
+// VALUE FORMAT
+#define MVALUEFORMAT    0xC0    // Mask
+#define MVF_RAW         0x00    // Raw bytes as saved
+#define MVF_COUNTER     0x40    // Counter kept in rotating word slots of a single page
+#define MVF_TIERED      0x80    // Value kept in the tier (KVATSetTier). Chain holds only its size (KVATSize).
+#define TIERKEYPREFIX   "\x1F"  // Tiered values are kept in the tier under their key after this (reserved), apart from its own keys
+#define MVF_EVICTABLE   0xC0    // Raw bytes as saved. Can be evicted when storage runs out (KVATSaveEvictable).
 
 //==========================================================
 // Internal types
@@ -89,6 +117,9 @@ typedef struct KVATKeyValueEntry{
     PageNumber keyPage;
     PageNumber valuePage;
     unsigned char remains; // Number of bytes that the value should be truncated from max page-chain (data) size
+#if CHANGELOG
+    uint32_t sequence;     // Store sequence of the last change. On a deleted entry (tombstone), the sequence of the delete. 0 on empty entries.
+#endif
 }KVATKeyValueEntry;
 
 // Index (header portion)
@@ -99,6 +130,9 @@ typedef struct KVATIndex{
     KVATSize pageSize;
     PageNumber pageCount;
     StorageAddress pageBeginAddress;   // Since this is 4 byte and 4-byte-aligned, the table (next) will be as well
+#if CHANGELOG
+    uint32_t sequenceFloor;            // Greatest sequence of a tombstone that was reclaimed. Changes up to it can't all be listed.
+#endif
     //KVATKeyValueEntry table[PAGECOUNT];
 }KVATIndex;
 
@@ -108,28 +142,86 @@ static KVATIndex* index = NULL;             // Runtime instance of KVATIndex, lo
 static void deinit();                       // Major fail safe. Call upon an unrecoverable exception to void runtime.
 static bool didInit = false;
 static unsigned char* pageRecord = NULL;
+static KVATSize activeEntryCount = 0;       // Number of active entries. Set by updatePageRecord(), kept by save, rename and delete.
+static const KVATFrozenStore* frozenStore = NULL;   // Read-only fallback for keys not in storage (KVATSetFrozenStore)
+static KVATBackend backend;                 // Storage the store runs on (KVATSetBackend). Internal EEPROM if init is NULL.
+static uint32_t storageSize = 0;            // Size of the storage in bytes, as given by the backend on init
+static const KVATTier* tier = NULL;         // Secondary store for large or cold values (KVATSetTier)
+static uint32_t* entryLastAccess = NULL;    // Per entry: tierOperation of its last read or save. Allocated when a tier moves cold values.
+static uint32_t tierOperation = 0;          // Reads and saves so far
+#if CHANGELOG
+static uint32_t storeSequence = 0;          // Last sequence given to a change. Set by updatePageRecord() (greatest in table, or floor).
+static PageNumber reclaimOldestTombstone(); // Turns the oldest tombstone into an empty entry. Call when entries or pages run out.
+#endif
+static unsigned char* entryReferenced = NULL;   // CLOCK bits: per entry, set on read. Cleared as the clock hand passes.
+static PageNumber evictionHand = 0;         // Last entry the clock looked at
+static PageNumber pinnedEntryN = 0;         // Entry being changed while not open (rename). Never evicted.
+static bool seedEvictionClock();            // Sets up the CLOCK bits from the table. Called with the page record.
+static bool isEntryHoldingChains(KVATKeyValueEntry* entry);    // Active entry or tombstone (KVATResize)
+static PageNumber evictColdestEntry();      // Evicts the coldest evictable entry. Call when entries or pages run out, after tombstones.
+
+//////////////////////////////////////////////////////////////////
+//  STORAGE
+
+/**
+ * Internal EEPROM backend.
+ */
+static bool eepromInit(void* context, uint32_t* size){
+    // Enable the EEPROM module.
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+
+    // Wait for the EEPROM module to be ready.
+    while(!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0));
+
+    if (MAP_EEPROMInit()==EEPROM_INIT_ERROR){return false;}
+
+    *size = MAP_EEPROMSizeGet();
+    return true;
+}
+
+static bool eepromRead(void* context, uint32_t address, void* data, uint32_t size){
+    MAP_EEPROMRead(data, address, size);
+    return true;
+}
+
+static bool eepromProgram(void* context, uint32_t address, const void* data, uint32_t size){
+    return MAP_EEPROMProgram((uint32_t*)data, address, size)==0;
+}
+
+/**
+ * Reads from storage. Address and size need to be multiples of 4 bytes.
+ *
+ * @return Boolean with success of operation.
+ */
+static bool readStorage(PageDataRef data, StorageAddress address, uint32_t size){
+    return backend.read(backend.context, address, data, size);
+}
+
+/**
+ * Programs into storage. Address and size need to be multiples of 4 bytes.
+ *
+ * @return Boolean with success of operation.
+ */
+static bool programStorage(ConstPageDataRef data, StorageAddress address, uint32_t size){
+    return backend.program(backend.context, address, data, size);
+}
 
 //==========================================================
 
 /**
  * Writes index into storage
  *
- * @return KVATException_ (storageFault) (heapError) (none)
+ * @return KVATException_ (storageFault) (none)
  */
 static KVATException saveIndex(){
 
-    // Produce a copy of the index to store
-    uint32_t* indexCopy = malloc(sizeof(KVATIndex));
-    if (indexCopy==NULL){return KVATException_heapError;}
-
+    // Produce a copy of the index to store (word aligned)
+    uint32_t indexCopy[sizeof(KVATIndex)/sizeof(uint32_t)];
     memcpy(indexCopy, index, sizeof(KVATIndex));
 
-    uint32_t programResult = MAP_EEPROMProgram(indexCopy, INDEXSTART, sizeof(KVATIndex));
+    bool didProgram = programStorage(indexCopy, INDEXSTART, sizeof(KVATIndex));
 
-    // Free space from the copy
-    free(indexCopy);
-
-    if (programResult!=0){  // Something came up with EEPROMProgram
+    if (!didProgram){  // Something came up with the program
         return KVATException_storageFault;
     }
 
@@ -139,23 +231,19 @@ static KVATException saveIndex(){
 /**
  * Reads stored index from storage into 'index'
  *
- * @return KVATException_ (invalidAccess) (heapError) (none)
+ * @return KVATException_ (invalidAccess) (storageFault) (none)
  */
 static KVATException readIndex(){
     if (index==NULL){return KVATException_invalidAccess;}
 
     // Read into compatible uint32_t buffer
-    uint32_t* indexBuff = malloc(sizeof(KVATIndex));
-    if (indexBuff==NULL){return KVATException_heapError;}
-    MAP_EEPROMRead(indexBuff, INDEXSTART, sizeof(KVATIndex));
+    uint32_t indexBuff[sizeof(KVATIndex)/sizeof(uint32_t)];
+    bool didRead = readStorage(indexBuff, INDEXSTART, sizeof(KVATIndex));
 
     // Copy into actual index
     memcpy(index, indexBuff, sizeof(KVATIndex));
 
-    // Get rid of buffer
-    free(indexBuff);
-
-    return KVATException_none;
+    return didRead ? KVATException_none : KVATException_storageFault;
 }
 
 /**
@@ -204,22 +292,15 @@ static StorageAddress getEntryAddressFromPosition(PageNumber entryPosition){
  */
 static bool saveTableEntry(KVATKeyValueEntry* entryToSave, PageNumber entryPosition){
 
-    // Copy table entry into compatible uint32_t pointer
-    uint32_t* entryCopy = malloc(sizeof(KVATKeyValueEntry));
-    if (entryCopy==NULL){return false;}
-
+    // Copy table entry into compatible uint32_t buffer
+    uint32_t entryCopy[sizeof(KVATKeyValueEntry)/sizeof(uint32_t)];
     memcpy(entryCopy, entryToSave, sizeof(KVATKeyValueEntry));
 
     // Get address of the table entry position to save in
     StorageAddress entryAddress = getEntryAddressFromPosition(entryPosition);
 
     // Program the entry into storage
-    uint32_t programResult = MAP_EEPROMProgram(entryCopy, entryAddress, sizeof(KVATKeyValueEntry));
-
-    // Get rid of the memory for copy
-    free(entryCopy);
-
-    return !programResult;
+    return programStorage(entryCopy, entryAddress, sizeof(KVATKeyValueEntry));
 }
 
 /**
@@ -232,26 +313,75 @@ static bool saveTableEntry(KVATKeyValueEntry* entryToSave, PageNumber entryPosit
  */
 static bool readTableEntry(KVATKeyValueEntry* entryRead, PageNumber entryPosition){
     // Prepare buffer to read into
-    uint32_t* entryBuff = malloc(sizeof(KVATKeyValueEntry));
-    if (entryBuff==NULL){return false;}
+    uint32_t entryBuff[sizeof(KVATKeyValueEntry)/sizeof(uint32_t)];
 
     // Get address of the table entry to read
     StorageAddress entryAddress = getEntryAddressFromPosition(entryPosition);
 
     // Read entry from storage
-    MAP_EEPROMRead(entryBuff, entryAddress, sizeof(KVATKeyValueEntry));
+    bool didRead = readStorage(entryBuff, entryAddress, sizeof(KVATKeyValueEntry));
 
     // Copy read data into the right place
     memcpy(entryRead, entryBuff, sizeof(KVATKeyValueEntry));
 
-    // Get rid of the read buffer
-    free(entryBuff);
+    return didRead;
+}
 
-    return true;
+/**
+ * Returns the number of table entries that fit in a batched table read or program.
+ *
+ * @return Number of entries.
+ */
+static PageNumber getEntryBatchCount(){
+    return EEPROMBLOCKSIZE/sizeof(KVATKeyValueEntry);
+}
+
+/**
+ * Writes a run of consecutive table entries into storage with a single program.
+ *
+ * @param      entriesToSave        Reference to the KVATKeyValueEntry instances to save
+ * @param      firstPosition        Position in the table of the first entry.
+ * @param      entryCount           Number of entries to save. Keep within getEntryBatchCount().
+ *
+ * @return Success of the save process. True if successful.
+ */
+static bool saveTableEntries(KVATKeyValueEntry* entriesToSave, PageNumber firstPosition, PageNumber entryCount){
+    KVATSize entriesSize = sizeof(KVATKeyValueEntry)*entryCount;
+
+    // Copy table entries into compatible uint32_t buffer
+    uint32_t entriesCopy[EEPROMBLOCKSIZE/sizeof(uint32_t)];
+    if (entriesSize>sizeof(entriesCopy)){return false;}
+
+    memcpy(entriesCopy, entriesToSave, entriesSize);
+
+    return programStorage(entriesCopy, getEntryAddressFromPosition(firstPosition), entriesSize);
+}
+
+/**
+ * Reads a run of consecutive table entries from storage with a single read.
+ *
+ * @param      entriesRead          Reference to the KVATKeyValueEntry instances to read into
+ * @param      firstPosition        Position in the table of the first entry.
+ * @param      entryCount           Number of entries to read. Keep within getEntryBatchCount().
+ *
+ * @return Success of the read process. True if successful.
+ */
+static bool readTableEntries(KVATKeyValueEntry* entriesRead, PageNumber firstPosition, PageNumber entryCount){
+    KVATSize entriesSize = sizeof(KVATKeyValueEntry)*entryCount;
+
+    uint32_t entriesBuff[EEPROMBLOCKSIZE/sizeof(uint32_t)];
+    if (entriesSize>sizeof(entriesBuff)){return false;}
+
+    bool didRead = readStorage(entriesBuff, getEntryAddressFromPosition(firstPosition), entriesSize);
+
+    memcpy(entriesRead, entriesBuff, entriesSize);
+
+    return didRead;
 }
 
 /**
  * Returns the number in the index table of an empty entry spot.
+ * If there is none, tombstones are reclaimed, then evictable values evicted.
  * Note: 0 is reserved for invalid page.
  *
  * @return Number of the empty entry, or 0 if all full (or fault).
@@ -269,10 +399,21 @@ static PageNumber getEmptyTableEntryNumber(){
         if (!didReadEntry){break;}   // Sanity check: if at any point table read fails, abort.
 
         if (!(entry.metadata & (MACTIVE | MOPEN))){ // Check status to see if actually empty
+#if CHANGELOG
+            if (entry.sequence){continue;}          // Tombstone. Only reclaimed if nothing else is empty.
+#endif
             return entryN;
         }
     }
-    return 0;
+#if CHANGELOG
+    PageNumber reclaimedEntryN = reclaimOldestTombstone();
+    if (reclaimedEntryN==0 && evictColdestEntry()){
+        reclaimedEntryN = reclaimOldestTombstone();  // The evicted entry, now the only tombstone
+    }
+    return reclaimedEntryN;
+#else
+    return evictColdestEntry();
+#endif
 }
 
 /**
@@ -285,6 +426,33 @@ static StorageAddress getNaturalAddressOfPage0(){
     return INDEXSTART + sizeof(KVATIndex) + sizeof(KVATKeyValueEntry)*PAGECOUNT;
 }
 
+/**
+ * Saves entries of the table as new (empty), from the one passed to the end. A batch at a time.
+ *
+ * @param      firstEntryN   First entry to clear. 0 for the whole table, including invalid entry 0.
+ * @param      entryCount    Number of entries in the table.
+ *
+ * @return KVATException_ (heapError) (tableError) (none)
+ */
+static KVATException clearTableEntries(KVATSize firstEntryN, KVATSize entryCount){
+    // A batch worth of empty entries
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* emptyEntries = calloc(batchCount, sizeof(KVATKeyValueEntry));   // MDEFAULT
+    if (emptyEntries==NULL){return KVATException_heapError;}
+
+    bool didSaveEntries = true;
+
+    for (KVATSize entryN = firstEntryN; entryN<entryCount && didSaveEntries; entryN += batchCount){
+        KVATSize entriesLeft = entryCount-entryN;
+        didSaveEntries = saveTableEntries(emptyEntries, entryN, entriesLeft<batchCount ? entriesLeft : batchCount);
+    }
+
+    free(emptyEntries);
+    if (!didSaveEntries){return KVATException_tableError;}
+
+    return KVATException_none;
+}
+
 /**
  * Formats storage based on defined formatting limits.
  * (Writes empty index)
@@ -301,16 +469,12 @@ static KVATException formatMemory(){
     index->pageSize = PAGESIZE;
     index->pageCount = PAGECOUNT;
     index->pageBeginAddress = getNaturalAddressOfPage0();
+#if CHANGELOG
+    index->sequenceFloor = 0;
+#endif
 
-    KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
-
-    bool didSaveEntry;
-
-    //Save entries as new (empty) (including invalid page 0)
-    for (PageNumber entryN = 0; entryN<PAGECOUNT; entryN++){
-        didSaveEntry = saveTableEntry(&emptyEntry, entryN);
-        if (!didSaveEntry){return KVATException_tableError;}
-    }
+    KVATException clearException = clearTableEntries(0, PAGECOUNT);
+    if (clearException!=KVATException_none){return clearException;}
 
     return saveIndex();
 }
@@ -326,7 +490,7 @@ static StorageAddress getPageAddress(PageNumber pageNumber){
     if (pageNumber==0){return 0;}
 
     // Convert page number into relative address
-    StorageAddress pageAddress = pageNumber*index->pageSize;
+    StorageAddress pageAddress = pageNumber*PAGESIZE;
 
     // Offset into absolute address
     pageAddress += index->pageBeginAddress;
@@ -340,12 +504,14 @@ static StorageAddress getPageAddress(PageNumber pageNumber){
  * @param[out] pageData        Reference to a buffer that will be used to dump the page data
  * @param      pageNumber      Number of the page to read.
  * @param      limitReadSize   Optional: Number of bytes to limit the reading to. Pass 0 to read entire length of page.
+ *
+ * @return Boolean with success of operation. pageData is not valid on failure.
  */
-static void readPage(PageDataRef pageData, PageNumber pageNumber, uint32_t limitReadSize){
+static bool readPage(PageDataRef pageData, PageNumber pageNumber, uint32_t limitReadSize){
     StorageAddress pageAddress = getPageAddress(pageNumber);
 
     // Read from address
-    MAP_EEPROMRead(pageData, pageAddress, limitReadSize ? limitReadSize : index->pageSize);
+    return readStorage(pageData, pageAddress, limitReadSize ? limitReadSize : PAGESIZE);
 }
 
 /**
@@ -361,9 +527,23 @@ static bool writePage(PageDataRef pageData, PageNumber pageNumber, uint32_t limi
     StorageAddress pageAddress = getPageAddress(pageNumber);
 
     // Write to address
-    uint32_t programResult = MAP_EEPROMProgram(pageData, pageAddress, limitWriteSize ? limitWriteSize : index->pageSize);
+    return programStorage(pageData, pageAddress, limitWriteSize ? limitWriteSize : PAGESIZE);
+}
+
+/**
+ * Writes a portion of a page to storage from a buffer. Offset and size need to be multiples of 4 bytes.
+ *
+ * @param      data            Reference to a buffer containing the data to write
+ * @param      pageNumber      Number of the page to write to.
+ * @param      offset          Position within the page to start writing at.
+ * @param      size            Number of bytes to write.
+ *
+ * @return Boolean with success of operation.
+ */
+static bool writePageSegment(PageDataRef data, PageNumber pageNumber, KVATSize offset, KVATSize size){
+    StorageAddress segmentAddress = getPageAddress(pageNumber)+offset;
 
-    return !programResult;
+    return programStorage(data, segmentAddress, size);
 }
 
 /**
@@ -383,23 +563,25 @@ static PageNumber getNextPageNumberFromPage(ConstPageDataRef pageData){
 }
 
 /**
- * Reads page from storage, obtains the number of the next page, and returns it.
+ * Reads page from storage and obtains the number of the next page.
  * Warning: Does not validate result. Pages do not contain metadata to validate on their own.
  *
  * @param      pageNumber        Page to get the next of.
+ * @param[out] nextPageNumber    Number of the page that is next.
  *
- * @return Number of the page that is next.
+ * @return Boolean with success of the read. nextPageNumber is not set on failure.
  */
-static PageNumber readNextPageNumber(PageNumber pageNumber){
+static bool readNextPageNumber(PageNumber pageNumber, PageNumber* nextPageNumber){
     PageData pageData;  // A single instance of PageData can contain the data for next page
-    readPage(&pageData, pageNumber, sizeof(PageData));
+    if (!readPage(&pageData, pageNumber, sizeof(PageData))){return false;}
 
-    return getNextPageNumberFromPage(&pageData);
+    *nextPageNumber = getNextPageNumberFromPage(&pageData);
+    return true;
 }
 
 static bool saveNextPageNumber(PageNumber pageNumber, PageNumber nextPageNumber){
     PageData pageData;  // A single instance of PageData (smallest chunk of a page) can contain the data for next page
-    readPage(&pageData, pageNumber, sizeof(PageData));              // Read smallest chunk of page (containing the next header)
+    if (!readPage(&pageData, pageNumber, sizeof(PageData))){return false;}     // Read smallest chunk of page (containing the next header)
     memcpy(&pageData, &nextPageNumber, sizeof(PageNumber));          // Modify next header portion
     return writePage(&pageData, pageNumber, sizeof(PageData));      // Save back into storage
 }
@@ -425,6 +607,21 @@ static KVATSize getPageRecordSize(){
     return (index->pageCount/8)+1;
 }
 
+/**
+ * Returns the first page clear of the table, for a table of the number of entries passed.
+ * Pages stay where the store was formatted, so a table grown by KVATResize covers the first ones.
+ *
+ * @param      entryCount        Number of entries in the table (page count).
+ *
+ * @return Number of the first page past the table. 1 on a table as formatted.
+ */
+static KVATSize getFirstUsablePage(KVATSize entryCount){
+    StorageAddress tableEnd = INDEXSTART + sizeof(KVATIndex) + sizeof(KVATKeyValueEntry)*entryCount;
+    if (tableEnd <= index->pageBeginAddress+PAGESIZE){return 1;}
+
+    return (tableEnd-index->pageBeginAddress + PAGESIZE-1)/PAGESIZE;
+}
+
 /**
  * Sets the status of a page in the runtime record.
  *
@@ -432,7 +629,7 @@ static KVATSize getPageRecordSize(){
  * @param      isUsed            The status to set. true if used.
  */
 static void markPageInRecord(PageNumber pageNumber, bool isUsed){
-    if (pageRecord==NULL){return;}
+    if (pageRecord==NULL || pageNumber>=index->pageCount){return;}     // Past the store: no record (a corrupt chain)
     KVATSize recordSegment = pageNumber/8;
     char recordBit = pageNumber%8;
 
@@ -508,6 +705,9 @@ static PageNumber getEmptyPageNumber(bool shouldMarkAsUsed){
         }
     }
 
+    // Record is full
+    if (recordSegment==pageRecordSize){return 0;}
+
     PageNumber emptyPageFound = recordSegment*8+recordBit;
 
     if (shouldMarkAsUsed && emptyPageFound){
@@ -517,6 +717,25 @@ static PageNumber getEmptyPageNumber(bool shouldMarkAsUsed){
     return emptyPageFound;
 }
 
+/**
+ * Takes an empty page for a chain being written and marks it as used.
+ * With CHANGELOG, tombstones are reclaimed (oldest first) when there are no empty pages left.
+ * Evictable values are evicted (coldest first) when that is not enough.
+ *
+ * @return Number of the page taken, or 0 if storage is full.
+ */
+static PageNumber allocatePage(){
+    PageNumber pageN = getEmptyPageNumber(true);
+#if CHANGELOG
+    while (pageN==0 && (reclaimOldestTombstone() || evictColdestEntry())){
+#else
+    while (pageN==0 && evictColdestEntry()){
+#endif
+        pageN = getEmptyPageNumber(true);
+    }
+    return pageN;
+}
+
 /**
  * Finds all the pages being used by a data chain starting in a specific page and sets the record.
  *
@@ -524,9 +743,10 @@ static PageNumber getEmptyPageNumber(bool shouldMarkAsUsed){
  * @param      isActive          Status used to set the pages of the chain as.
  * @param      isMultiple        Indicates if a chain is multiple pages.
  *
+ * @return Boolean with success of operation. On a read fault, the pages past the one that couldn't be read keep their status.
  */
-static void followPageChainAndSetPageRecord(PageNumber chainStart, bool isActive, bool isChainMultiple){
-    if (chainStart==0){return;}
+static bool followPageChainAndSetPageRecord(PageNumber chainStart, bool isActive, bool isChainMultiple){
+    if (chainStart==0){return true;}
 
     PageNumber currentPageN = chainStart;
     PageNumber chainPageN = 0;// Marks the position of the current page in the chain
@@ -538,7 +758,7 @@ static void followPageChainAndSetPageRecord(PageNumber chainStart, bool isActive
 
         if (isChainMultiple){
             // Get next page
-            currentPageN = readNextPageNumber(currentPageN);
+            if (!readNextPageNumber(currentPageN, &currentPageN)){return false;}
         }else{
             // There is no next page on single chains
             currentPageN = 0;
@@ -547,6 +767,8 @@ static void followPageChainAndSetPageRecord(PageNumber chainStart, bool isActive
         // Add to safe limiter
         chainPageN++;
     }
+
+    return true;
 }
 
 /**
@@ -572,32 +794,215 @@ static bool updatePageRecord(){
     // Set page 0 to used (reserved)
     markPageInRecord(0, true);
 
+    // Set the pages under a grown table to used (KVATResize)
+    KVATSize firstUsablePage = getFirstUsablePage(index->pageCount);
+    for (KVATSize pageN = 1; pageN<firstUsablePage && pageN<index->pageCount; pageN++){
+        markPageInRecord(pageN, true);
+    }
+
+    // Set the tail of the last record segment to used (those pages don't exist)
+    for (KVATSize pageN = index->pageCount; pageN<pageRecordSize*8; pageN++){
+        pageRecord[pageN/8] |= 1<<(pageN%8);
+    }
+
     // Keep the number of existing entries locally (table entries equals the number of available pages)
     PageNumber numberOfEntries = index->pageCount;
     KVATKeyValueEntry entry;
 
+    activeEntryCount = 0;
+#if CHANGELOG
+    storeSequence = index->sequenceFloor;
+#endif
+
     bool didReadEntry;
 
+    // Key page of every entry with chains. A shrink (KVATResize) copies an entry into the table, then clears it
+    // past the table. Cut in between, both are in: the second entry on a key page is the one left behind.
+    unsigned char keyPagesSeen[(PAGECOUNTMAX+1)/8];
+    memset(keyPagesSeen, 0, sizeof(keyPagesSeen));
+
     // Go through all table entries (starting at 1)
     for (PageNumber entryN = 1; entryN<numberOfEntries; entryN++){
         didReadEntry = readTableEntry(&entry, entryN);
         if (!didReadEntry){return false;}
 
+        // Open but never active: a save or stream of a new key cut by a reset. Its chains are not followed (free).
+        if ((entry.metadata & (MACTIVE | MOPEN))==MOPEN){
+            KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+            if (!saveTableEntry(&emptyEntry, entryN)){return false;}
+            continue;
+        }
+
+        if (isEntryHoldingChains(&entry)){
+            if (keyPagesSeen[entry.keyPage/8] & 1<<(entry.keyPage%8)){
+                KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+                if (!saveTableEntry(&emptyEntry, entryN)){return false;}
+                continue;
+            }
+            keyPagesSeen[entry.keyPage/8] |= 1<<(entry.keyPage%8);
+        }
+
         // Check if entry is active and follow chains for name and value to update records
         if (entry.metadata & MACTIVE){
             //Follow key
-            followPageChainAndSetPageRecord(entry.keyPage, true, entry.metadata & MKC_ISMULTIPLE);
+            if (!followPageChainAndSetPageRecord(entry.keyPage, true, entry.metadata & MKC_ISMULTIPLE)){return false;}
             //Follow value
-            followPageChainAndSetPageRecord(entry.valuePage, true, entry.metadata & MVC_ISMULTIPLE);
+            if (!followPageChainAndSetPageRecord(entry.valuePage, true, entry.metadata & MVC_ISMULTIPLE)){return false;}
+
+            activeEntryCount++;
+        }
+#if CHANGELOG
+        else if (!(entry.metadata & MOPEN) && entry.sequence){
+            // Tombstone: keeps its key
+            if (!followPageChainAndSetPageRecord(entry.keyPage, true, entry.metadata & MKC_ISMULTIPLE)){return false;}
+        }
+
+        if (entry.sequence>storeSequence){
+            storeSequence = entry.sequence;
         }
+#endif
     }
 
-    return true;
+    return seedEvictionClock();
+}
+
+//////////////////////////////////////////////////////////////////
+//  CHANGE LOG
+
+/**
+ * Marks an active entry as deleted (the entry is not saved, and no pages are released).
+ * With CHANGELOG, the entry becomes a tombstone: it keeps its key and gets the sequence of the delete.
+ *
+ * @param      entry         Reference to the entry to mark.
+ */
+static void setEntryDeleted(KVATKeyValueEntry* entry){
+#if CHANGELOG
+    entry->metadata &= MKC_ISMULTIPLE;
+    entry->sequence = ++storeSequence;
+#else
+    entry->metadata = MDEFAULT;
+#endif
+}
+
+/**
+ * Returns to record the pages that a deleted entry no longer needs. Call after the entry is saved.
+ *
+ * @param      entry            Reference to the deleted entry.
+ * @param      formerMetadata   Metadata of the entry before it was deleted.
+ */
+static void releaseDeletedEntryPages(KVATKeyValueEntry* entry, MetaData formerMetadata){
+#if !CHANGELOG
+    followPageChainAndSetPageRecord(entry->keyPage, false, formerMetadata & MKC_ISMULTIPLE);
+#endif
+    followPageChainAndSetPageRecord(entry->valuePage, false, formerMetadata & MVC_ISMULTIPLE);
+}
+
+#if CHANGELOG
+/**
+ * Raises the sequence floor of the index and saves it. Changes up to the floor can no longer be listed completely.
+ *
+ * @param      sequence      Sequence of the change that was lost.
+ *
+ * @return boolean of operation result. true on success.
+ */
+static bool raiseSequenceFloor(uint32_t sequence){
+    if (sequence<=index->sequenceFloor){return true;}
+
+    index->sequenceFloor = sequence;
+    return saveIndex()==KVATException_none;
+}
+
+static PageNumber reclaimOldestTombstone(){
+    PageNumber oldestEntryN = 0;
+    KVATKeyValueEntry oldestEntry = {.metadata = MDEFAULT};
+    KVATKeyValueEntry entry;
+
+    for (PageNumber entryN = 1; entryN<index->pageCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){return 0;}
+
+        bool isTombstone = !(entry.metadata & (MACTIVE | MOPEN)) && entry.sequence;
+        if (isTombstone && (oldestEntryN==0 || entry.sequence<oldestEntry.sequence)){
+            oldestEntryN = entryN;
+            oldestEntry = entry;
+        }
+    }
+    if (oldestEntryN==0){return 0;}
+
+    // Floor goes up before the tombstone is gone
+    if (!raiseSequenceFloor(oldestEntry.sequence)){return 0;}
+
+    KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+    if (!saveTableEntry(&emptyEntry, oldestEntryN)){return 0;}
+
+    followPageChainAndSetPageRecord(oldestEntry.keyPage, false, oldestEntry.metadata & MKC_ISMULTIPLE);
+
+    return oldestEntryN;
 }
+#endif
 
 //////////////////////////////////////////////////////////////////
 //  FETCH
 
+/**
+ * Counts the pages in a data chain. Only the next segment of each page is read, never the data.
+ *
+ * @param      startPage          The number of the page that the data chain starts on.
+ * @param      isChainMultiple    The type of chain. Pass true for a multiple page chain.
+ *
+ * @return Number of pages in the chain. 0 on read fault.
+ */
+static PageNumber getChainPageCount(PageNumber startPage, bool isChainMultiple){
+    PageNumber pageCount = 1;
+    PageNumber currentPageN = startPage;
+    if (isChainMultiple){   // Only perform chain size calculation if chain is multiple pages
+
+        for (; pageCount < index->pageCount; pageCount++){
+            if (!readNextPageNumber(currentPageN, &currentPageN)){return 0;}
+
+            if (currentPageN == 0){
+                break;
+            }
+        }
+    }
+
+    return pageCount;
+}
+
+/**
+ * Reads the size of a tiered value from its stub.
+ *
+ * @param      entry          Reference to an active entry with MVF_TIERED format.
+ *
+ * @return Size of the value in the tier, in bytes. 0 on read fault.
+ */
+static KVATSize getTieredValueSize(KVATKeyValueEntry* entry){
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
+    if (!readPage(singlePage, entry->valuePage, 0)){return 0;}
+
+    KVATSize size;
+    memcpy(&size, (char*)singlePage+getPageNextSize(entry->metadata & MVC_ISMULTIPLE), sizeof(KVATSize));
+    return size;
+}
+
+/**
+ * Calculates the size of the value an entry points to. Single page values are sized from the entry alone.
+ *
+ * @param      entry          Reference to an active entry.
+ *
+ * @return Size of the value in bytes. 0 on read fault (values are never empty).
+ */
+static KVATSize getEntryValueSize(KVATKeyValueEntry* entry){
+    if ((entry->metadata & MVALUEFORMAT)==MVF_TIERED){return getTieredValueSize(entry);}
+
+    bool isChainMultiple = getMetadataBool(entry, MVC_ISMULTIPLE);
+    KVATSize pageDataSize = PAGESIZE-getPageNextSize(isChainMultiple);
+
+    PageNumber pageCount = getChainPageCount(entry->valuePage, isChainMultiple);
+    if (pageCount==0){return 0;}
+
+    return pageDataSize*pageCount-entry->remains;
+}
+
 /**
  * Allocates!
  * Pulls entire data chain into a single allocated buffer and returns pointer. Extra null terminated after max size for security.
@@ -612,26 +1017,16 @@ static bool updatePageRecord(){
  * @param      preallocBufferSize          Optional: The size of the preallocated buffer.
  * @param      forceFetchOnPreallocBuffer  Optional: Indicates if preallocated buffer should be used even if unfit.
  *
- * @return Pointer to allocated buffer, preallocated buffer if used, or NULL.
+ * @return Pointer to allocated buffer, preallocated buffer if used, or NULL (also on read fault).
  */
 static PageDataRef fetchData(PageNumber startPage, bool isChainMultiple, KVATSize* maxSize, PageDataRef preallocBuffer, KVATSize preallocBufferSize, bool forceFetchOnPreallocBuffer){
     //Get total size of chain
-    PageNumber pageCount = 1;
-    PageNumber currentPageN = startPage;
-    if (isChainMultiple){   // Only perform chain size calculation if chain is multiple pages
-
-        for (; pageCount < index->pageCount; pageCount++){
-            currentPageN = readNextPageNumber(currentPageN);
-
-            if (currentPageN == 0){
-                break;
-            }
-        }
-    }
+    PageNumber pageCount = getChainPageCount(startPage, isChainMultiple);
+    if (pageCount==0){return NULL;}
 
     // Calculate page internal sizes (take into account the single page case)
     KVATSize pageNextSize = getPageNextSize(isChainMultiple);
-    KVATSize pageDataSize = index->pageSize-pageNextSize;
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
     KVATSize recordSize = pageDataSize*pageCount+1; // Size of the record being fetched (rounded up by page count) (plus 1 byte for null terminator)
 
     // See if trimming is necessary as a result from forceFetchOnPreallocBuffer
@@ -644,24 +1039,28 @@ static PageDataRef fetchData(PageNumber startPage, bool isChainMultiple, KVATSiz
         if (lastPageTrim){pageCount++;};
     }
 
-    // Make buffer to keep a single page
-    PageDataRef singlePage = malloc(index->pageSize);
-    if (singlePage==NULL){return NULL;}
+    // Buffer to keep a single page
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
 
     // Returnable allocation, see if preallocated buffer can (or should) be used
     PageDataRef record = (preallocBuffer!=NULL && preallocBufferSize>=recordSize) ? preallocBuffer : malloc(recordSize);
-    if (record==NULL){free(singlePage); return NULL;}
+    if (record==NULL){return NULL;}
 
     // Add null terminator in extra byte (cast to char* so it's indexed by bytes)
     ((char*)record)[recordSize-1] = '\0';
 
-    // Restart current page number
-    currentPageN = startPage;
+    // Start at first page
+    PageNumber currentPageN = startPage;
 
     // Fetch into buffer
     for (PageNumber i = 0; i<pageCount; i++){
         // Get the page (with next page pointer and all)
-        readPage(singlePage, currentPageN, 0);
+        if (!readPage(singlePage, currentPageN, 0)){
+            if (record!=preallocBuffer){
+                free(record);
+            }
+            return NULL;
+        }
 
         // Only transfer data to nice record
         // Cast to char* [legal move] to do pointer arithmetic
@@ -675,9 +1074,6 @@ static PageDataRef fetchData(PageNumber startPage, bool isChainMultiple, KVATSiz
         currentPageN = getNextPageNumberFromPage(singlePage);
     }
 
-    // Free space from single page
-    free(singlePage);
-
     // Write to inout maxSize
     if (maxSize!=NULL){
         *maxSize = pageCount*pageDataSize;
@@ -686,75 +1082,200 @@ static PageDataRef fetchData(PageNumber startPage, bool isChainMultiple, KVATSiz
     return record;
 }
 
-//////////////////////////////////////////////////////////////////
-//  WRITE
-
 /**
- * Programs data into a page chain in storage.
+ * Compares a data chain in storage against data in memory, one page at a time.
+ * Stops reading at the first difference.
  *
- * @param      data                      Data to be written to storage.
- * @param      size                      Size of data to be written (in bytes).
- * @param      reuseChainStartPage       Optional: Page number of the beginning of an existing chain to overwrite with data
- * @param      isReuseChainMultiple      Optional: Boolean to indicate if overwrite chain is multiple pages
- * @param[out] didSaveInMultipleChain    Optional: Indicates if data was saved into a chain with multiple pages
- * @param[out] remains                   Optional: Indicates how much space was left empty in the last page written.
+ * @param      startPage         The number of the page that the data chain starts on.
+ * @param      isChainMultiple   The type of chain. Pass true for a multiple page chain.
+ * @param      remains           Bytes the value is truncated from the chain's max size (as kept in entry).
+ * @param      data              Data to compare against.
+ * @param      size              Size of data (in bytes).
  *
- * @return Number of first page in the chain. Returns 0 (illegal page) to indicate insufficient space to store, invalid call, or error.
- *         If write operation runs out
+ * @return true if the chain holds exactly the data passed. false on read fault.
  */
-static PageNumber writeData(ConstPageDataRef data, KVATSize size, PageNumber reuseChainStartPage, bool isReuseChainMultiple, bool* didSaveInMultipleChain, KVATSize* remains){
-    if (size==0){return 0;}
+static bool compareData(PageNumber startPage, bool isChainMultiple, KVATSize remains, const void* data, KVATSize size){
+    if (startPage==0){return false;}
 
-    // Calculate if data fits in single page
-    bool isMultipleChain = size > index->pageSize;
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
 
-    // Calculate the page segment sizes
-    KVATSize pageSize = index->pageSize;
-    KVATSize pageNextSize = getPageNextSize(isMultipleChain);
-    KVATSize pageDataSize = pageSize-pageNextSize;
+    // Buffer to keep a single page
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
 
-    // Calculate pages needed (easy when it's single page)
-    PageNumber pagesNeeded = isMultipleChain ? size/pageDataSize : 1;
-    if (isMultipleChain && size%pageDataSize){ // Get crude ceil of division
-        pagesNeeded++;
-    }
+    bool isEqual = true;
+    KVATSize compared = 0;
+    PageNumber currentPageN = startPage;
 
-    // Guard pages needed (see if it's not even feasible)
-    if (pagesNeeded > index->pageCount){return 0;}
+    for (PageNumber i = 0; currentPageN!=0 && i<index->pageCount; i++){
+        if (!readPage(singlePage, currentPageN, 0)){return false;}
 
-    // Get buffer to hold page data when assembling before saving
-    PageDataRef pageData = malloc(index->pageSize);
-    if (pageData==NULL){return 0;}
+        currentPageN = isChainMultiple ? getNextPageNumberFromPage(singlePage) : 0;
 
-    // Support for overwrite chain
-    PageNumber reuseChainNext = reuseChainStartPage ? reuseChainStartPage : 0; // Page from reuse chain for next loop, if any
-    PageNumber reuseChainDryI = 0; // First iteration in which reuse chain wasn't used.
+        // Last page only holds what is not in remains
+        KVATSize pageValueSize = currentPageN ? pageDataSize : pageDataSize-remains;
 
-    // Prepare place to keep track of the pages used
-    PageNumber* pagesUsed = malloc(sizeof(PageNumber)*pagesNeeded);
-    if (pagesUsed==NULL){free(pageData); return 0;}
+        if (compared+pageValueSize > size || memcmp((char*)singlePage+pageNextSize, (const char*)data+compared, pageValueSize)!=0){
+            isEqual = false;
+            break;
+        }
 
-    // Effective trackers. The loop cycles thisPage into nextPage before using.
-    PageNumber thisPageN = 0;
-    PageNumber nextPageN = reuseChainNext ? reuseChainNext : getEmptyPageNumber(true);
+        compared += pageValueSize;
+    }
 
-    for (PageNumber currentPageI = 0; currentPageI<pagesNeeded; currentPageI++){
+    return isEqual && compared==size;
+}
 
-        // =========================================
-        // == MANAGE & VALIDATE PAGING
-        // =========================================
+/**
+ * Passes a data chain to a writer one page at a time, through a fixed single page buffer.
+ *
+ * @param      startPage         The number of the page that the data chain starts on.
+ * @param      isChainMultiple   The type of chain. Pass true for a multiple page chain.
+ * @param      remains           Bytes the value is truncated from the chain's max size (as kept in entry).
+ * @param      writer            Function that receives the data.
+ * @param      context           Passed to writer as is.
+ *
+ * @return KVATException_ (fetchFault) (storageFault) (none)
+ *         storageFault if writer fails.
+ */
+static KVATException streamData(PageNumber startPage, bool isChainMultiple, KVATSize remains, KVATExportWriter writer, void* context){
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
 
-        // Try to cycle to the next overwriteChainNext.
-        // Will be transfered to nextPageN before paging managing ends to be used on next loop (if valid).
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
+    PageNumber currentPageN = startPage;
 
-        if (reuseChainNext && isReuseChainMultiple){ // If the reuse chain "next" from last loop was from a multiple page chain,
-                                                     // maybe there is more for next loop.
+    for (PageNumber i = 0; currentPageN!=0; i++){
+        if (i>=index->pageCount){return KVATException_fetchFault;}  // Chain loops
 
-            reuseChainNext = readNextPageNumber(reuseChainNext); // This will find it.
-                                                                 // Or set to 0 if it's filled
-                                                                 // (no more) (nothing for next loop).
+        if (!readPage(singlePage, currentPageN, 0)){return KVATException_fetchFault;}
 
-            // If reuse chain will not be used on next loop, that is the dry iteration
+        currentPageN = isChainMultiple ? getNextPageNumberFromPage(singlePage) : 0;
+
+        // Last page only holds what is not in remains
+        KVATSize pageValueSize = currentPageN ? pageDataSize : pageDataSize-remains;
+        if (!writer((char*)singlePage+pageNextSize, pageValueSize, context)){return KVATException_storageFault;}
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Measures a key chain without fetching it, reading a page at a time up to the terminator.
+ *
+ * @param      startPage         The number of the page that the key chain starts on.
+ * @param      isChainMultiple   The type of chain. Pass true for a multiple page chain.
+ * @param[out] remains           Bytes of the last page past the terminator (as remains of a value, for streamData).
+ *
+ * @return Size of the key with its terminator. 0 if the chain holds no terminator, or on read fault.
+ */
+static KVATSize measureKeyChain(PageNumber startPage, bool isChainMultiple, KVATSize* remains){
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
+
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
+    PageNumber currentPageN = startPage;
+    KVATSize measured = 0;
+
+    for (PageNumber i = 0; currentPageN!=0 && i<index->pageCount; i++){
+        if (!readPage(singlePage, currentPageN, 0)){return 0;}
+
+        const char* terminator = memchr((char*)singlePage+pageNextSize, '\0', pageDataSize);
+        if (terminator!=NULL){
+            KVATSize pageKeySize = terminator-((char*)singlePage+pageNextSize)+1;
+            *remains = pageDataSize-pageKeySize;
+            return measured+pageKeySize;
+        }
+
+        measured += pageDataSize;
+        currentPageN = isChainMultiple ? getNextPageNumberFromPage(singlePage) : 0;
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+//  WRITE
+
+static PageNumber writePagesUsed[PAGECOUNTMAX];    // Pages taken by the chain being written (writeData). Not reentered: eviction callbacks don't call into the store.
+
+/**
+ * Programs data into a page chain in storage.
+ *
+ * @param      data                      Data to be written to storage.
+ * @param      size                      Size of data to be written (in bytes).
+ * @param      reuseChainStartPage       Optional: Page number of the beginning of an existing chain to overwrite with data
+ * @param      isReuseChainMultiple      Optional: Boolean to indicate if overwrite chain is multiple pages
+ * @param[out] didSaveInMultipleChain    Optional: Indicates if data was saved into a chain with multiple pages
+ * @param[out] remains                   Optional: Indicates how much space was left empty in the last page written.
+ * @param[out] failure                   Optional: Why 0 was returned. KVATException_ (insufficientSpace) (fetchFault) (storageFault)
+ *                                                 fetchFault if the reuse chain can't be followed. storageFault if a page program fails.
+ *
+ * @return Number of first page in the chain. Returns 0 (illegal page) to indicate insufficient space to store, invalid call, or error.
+ *         If write operation runs out
+ */
+static PageNumber writeData(ConstPageDataRef data, KVATSize size, PageNumber reuseChainStartPage, bool isReuseChainMultiple, bool* didSaveInMultipleChain, KVATSize* remains, KVATException* failure){
+    if (failure!=NULL){
+        *failure = KVATException_insufficientSpace;
+    }
+    if (size==0){return 0;}
+
+    // Calculate if data fits in single page
+    bool isMultipleChain = size > PAGESIZE;
+
+    // Calculate the page segment sizes
+    KVATSize pageNextSize = getPageNextSize(isMultipleChain);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
+
+    // Calculate pages needed (easy when it's single page)
+    PageNumber pagesNeeded = isMultipleChain ? size/pageDataSize : 1;
+    if (isMultipleChain && size%pageDataSize){ // Get crude ceil of division
+        pagesNeeded++;
+    }
+
+    // Guard pages needed (see if it's not even feasible)
+    if (pagesNeeded > index->pageCount){return 0;}
+
+    // Buffer to hold page data when assembling before saving
+    PageData pageData[PAGESIZE/sizeof(PageData)];
+
+    // Support for overwrite chain
+    PageNumber reuseChainNext = reuseChainStartPage ? reuseChainStartPage : 0; // Page from reuse chain for next loop, if any
+    PageNumber reuseChainDryI = 0; // First iteration in which reuse chain wasn't used.
+
+    // Place to keep track of the pages used
+    PageNumber* pagesUsed = writePagesUsed;
+
+    // Effective trackers. The loop cycles thisPage into nextPage before using.
+    PageNumber thisPageN = 0;
+    PageNumber nextPageN = reuseChainNext ? reuseChainNext : allocatePage();
+    KVATException fault = KVATException_none;   // Storage fault that stops the write
+
+    for (PageNumber currentPageI = 0; currentPageI<pagesNeeded; currentPageI++){
+
+        // =========================================
+        // == MANAGE & VALIDATE PAGING
+        // =========================================
+
+        // Try to cycle to the next overwriteChainNext.
+        // Will be transfered to nextPageN before paging managing ends to be used on next loop (if valid).
+
+        if (reuseChainNext && isReuseChainMultiple){ // If the reuse chain "next" from last loop was from a multiple page chain,
+                                                     // maybe there is more for next loop.
+
+            if (!readNextPageNumber(reuseChainNext, &reuseChainNext)){ // This will find it.
+                                                                       // Or set to 0 if it's filled
+                                                                       // (no more) (nothing for next loop).
+
+                // The rest of the reuse chain is unknown. Keep it as it is (and in use) and stop.
+                // Every page written so far belongs to it: none to return.
+                reuseChainNext = 0;
+                pagesUsed[0] = 0;
+                fault = KVATException_fetchFault;
+                break;
+            }
+
+            // If reuse chain will not be used on next loop, that is the dry iteration
             if (!reuseChainNext){
                 reuseChainDryI = currentPageI+1;
             }
@@ -797,7 +1318,7 @@ static PageNumber writeData(ConstPageDataRef data, KVATSize size, PageNumber reu
         if (currentPageI+1<pagesNeeded){ // Need another page
 
             // Try to reuse chain if available
-            nextPageN = reuseChainNext ? reuseChainNext : getEmptyPageNumber(true);
+            nextPageN = reuseChainNext ? reuseChainNext : allocatePage();
 
         }else{ // No more pages needed
 
@@ -812,18 +1333,40 @@ static PageNumber writeData(ConstPageDataRef data, KVATSize size, PageNumber reu
         memcpy(pageData, &nextPageN, pageNextSize);
 
         // Write actual data - cast to char* [legal move] to do pointer arithmetic
-        memcpy((char*)pageData+pageNextSize, (const char*)data+pageDataSize*currentPageI, pageDataSize);
+        // Last page only holds what is left of data, rest is cleared.
+        KVATSize dataLeft = size-pageDataSize*currentPageI;
+        KVATSize transferSize = dataLeft<pageDataSize ? dataLeft : pageDataSize;
+        memcpy((char*)pageData+pageNextSize, (const char*)data+pageDataSize*currentPageI, transferSize);
+        memset((char*)pageData+pageNextSize+transferSize, 0, pageDataSize-transferSize);
 
         // Page is complete, now put it on storage. Write the whole page (no limit).
-        writePage(pageData, thisPageN, 0);
+        if (!writePage(pageData, thisPageN, 0)){
+
+            // Return the new pages, this one included. Pages of the reuse chain stay linked and in use.
+            PageNumber firstNewI = (reuseChainStartPage && !reuseChainDryI) ? currentPageI+1 : reuseChainDryI;
+            for (PageNumber returnI = firstNewI; returnI<=currentPageI; returnI++){
+                markPageInRecord(pagesUsed[returnI], false);
+            }
+            if (nextPageN && nextPageN!=reuseChainNext){
+                markPageInRecord(nextPageN, false);
+            }
+            if (isReuseChainMultiple && firstNewI && firstNewI<=currentPageI){
+                saveNextPageNumber(pagesUsed[firstNewI-1], 0);
+            }
+
+            reuseChainNext = 0;
+            pagesUsed[0] = 0;
+            fault = KVATException_storageFault;
+            break;
+        }
 
     }
 
-    // free allocated buffer
-    free(pageData);
+    PageNumber firstPageN = pagesUsed[0];
 
-    // Free pages used tracker
-    free(pagesUsed);
+    if (fault!=KVATException_none && failure!=NULL){
+        *failure = fault;
+    }
 
     // Write to inout wasMultipleChain
     if (didSaveInMultipleChain!=NULL){
@@ -842,8 +1385,181 @@ static PageNumber writeData(ConstPageDataRef data, KVATSize size, PageNumber reu
     }
 
     // Return page number of first page
-    return pagesUsed[0];
+    return firstPageN;
+
+}
+
+//////////////////////////////////////////////////////////////////
+//  CHAIN WRITER
+
+// Keeps the progress of a page chain being written in pieces.
+// Only a single page is held in memory at any time.
+typedef struct ChainWriter{
+    PageDataRef pageData;       // Buffer for the page being assembled
+    KVATSize pageNextSize;      // Size of the next page segment in each page
+    KVATSize pageDataSize;      // Size of the data segment in each page
+    KVATSize expectedSize;      // Total size the chain will hold when complete
+    KVATSize writtenSize;       // Bytes received so far
+    KVATSize pageFill;          // Bytes of data currently in pageData
+    PageNumber firstPage;       // Start of the chain
+    PageNumber currentPage;     // Page that pageData will be written into
+    PageNumber pagesWritten;    // Pages already programmed into storage (excluding currentPage)
+    bool isMultipleChain;
+}ChainWriter;
+
+/**
+ * Prepares a chain writer and obtains the first page for the chain.
+ *
+ * @param[out] writer          Reference to the writer to prepare.
+ * @param      expectedSize    Total size of the data that will be written into the chain.
+ *
+ * @return Boolean with success of operation. false on invalid size, no space or heap failure.
+ */
+static bool beginChainWrite(ChainWriter* writer, KVATSize expectedSize){
+    writer->pageData = NULL;
+    if (expectedSize==0){return false;}
+
+    writer->isMultipleChain = expectedSize > PAGESIZE;
+    writer->pageNextSize = getPageNextSize(writer->isMultipleChain);
+    writer->pageDataSize = PAGESIZE-writer->pageNextSize;
+    writer->expectedSize = expectedSize;
+    writer->writtenSize = 0;
+    writer->pageFill = 0;
+    writer->pagesWritten = 0;
+
+    // Guard pages needed (see if it's not even feasible)
+    KVATSize pagesNeeded = expectedSize/writer->pageDataSize + (expectedSize%writer->pageDataSize ? 1 : 0);
+    if (pagesNeeded > index->pageCount){return false;}
+
+    writer->pageData = malloc(PAGESIZE);
+    if (writer->pageData==NULL){return false;}
+
+    writer->firstPage = allocatePage();
+    writer->currentPage = writer->firstPage;
+    if (writer->firstPage==0){
+        free(writer->pageData);
+        writer->pageData = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Programs the page being assembled, linking it to the next page in the chain.
+ *
+ * @param      writer          Reference to an active writer.
+ * @param      nextPage        Number of the page that follows (0 to terminate chain).
+ *
+ * @return Boolean with success of operation.
+ */
+static bool flushChainWritePage(ChainWriter* writer, PageNumber nextPage){
+    // Write next page number into the working page
+    memcpy(writer->pageData, &nextPage, writer->pageNextSize);
+
+    // Clear unused portion of the data segment (last page)
+    memset((char*)writer->pageData+writer->pageNextSize+writer->pageFill, 0, writer->pageDataSize-writer->pageFill);
+
+    if (!writePage(writer->pageData, writer->currentPage, 0)){return false;}
+
+    writer->pagesWritten++;
+    writer->currentPage = nextPage;
+    writer->pageFill = 0;
+    return true;
+}
+
+/**
+ * Adds data to a chain being written. Full pages are programmed as soon as the next one is needed.
+ *
+ * @param      writer          Reference to an active writer.
+ * @param      data            Data to append.
+ * @param      size            Size of data to append (in bytes).
+ *
+ * @return Boolean with success of operation. false if data exceeds expected size, no space, or storage failure.
+ */
+static bool appendChainWrite(ChainWriter* writer, const void* data, KVATSize size){
+    if (writer->writtenSize+size > writer->expectedSize){return false;}
+
+    KVATSize consumed = 0;
+    while (consumed<size){
+
+        // Current page is full and more data is coming. Link to a new page and program.
+        if (writer->pageFill==writer->pageDataSize){
+            PageNumber nextPage = allocatePage();
+            if (nextPage==0){return false;}
+
+            if (!flushChainWritePage(writer, nextPage)){
+                markPageInRecord(nextPage, false);
+                return false;
+            }
+        }
+
+        // Fill as much of the current page as possible
+        KVATSize pageRoom = writer->pageDataSize-writer->pageFill;
+        KVATSize transfer = (size-consumed < pageRoom) ? size-consumed : pageRoom;
+        memcpy((char*)writer->pageData+writer->pageNextSize+writer->pageFill, (const char*)data+consumed, transfer);
+
+        writer->pageFill += transfer;
+        writer->writtenSize += transfer;
+        consumed += transfer;
+    }
+
+    return true;
+}
+
+/**
+ * Programs the last page of a chain and releases the writer.
+ *
+ * @param      writer          Reference to an active writer. All expected data must have been appended.
+ * @param[out] remains         Optional: Indicates how much space was left empty in the last page written.
+ *
+ * @return Number of first page in the chain. 0 on incomplete data or storage failure (writer is not released then).
+ */
+static PageNumber endChainWrite(ChainWriter* writer, KVATSize* remains){
+    if (writer->writtenSize!=writer->expectedSize){return 0;}
+
+    PageNumber lastPage = writer->currentPage;
+    KVATSize lastFill = writer->pageFill;
+
+    if (!flushChainWritePage(writer, 0)){
+        writer->currentPage = lastPage;
+        return 0;
+    }
+
+    free(writer->pageData);
+    writer->pageData = NULL;
+
+    if (remains!=NULL){
+        *remains = writer->pageDataSize-lastFill;
+    }
 
+    return writer->firstPage;
+}
+
+/**
+ * Discards a chain being written. Every page obtained for it is returned to the page record.
+ *
+ * @param      writer          Reference to an active writer.
+ */
+static void abortChainWrite(ChainWriter* writer){
+    if (writer->pageData==NULL){return;}
+
+    // Pages already programmed are linked through their next segment
+    PageNumber pageN = writer->firstPage;
+    for (PageNumber i = 0; i<writer->pagesWritten && pageN!=0; i++){
+        PageNumber nextPageN = 0;
+        if (writer->isMultipleChain && !readNextPageNumber(pageN, &nextPageN)){break;}   // Rest stays in use until the next updatePageRecord
+        markPageInRecord(pageN, false);
+        pageN = nextPageN;
+    }
+
+    // The page being assembled was never programmed
+    if (writer->currentPage){
+        markPageInRecord(writer->currentPage, false);
+    }
+
+    free(writer->pageData);
+    writer->pageData = NULL;
 }
 
 //////////////////////////////////////////////////////////////////
@@ -922,267 +1638,3353 @@ static PageNumber lookupByKey(const char* key, bool isPartialKey, PageNumber ent
     return match;
 }
 
-//////////////////////////////////////////////////////////////////
-//  PUBLIC SAVE
+/**
+ * Compares a key chain against a key in memory, one page at a time. Stops reading at the first difference.
+ *
+ * @param      keyPage           The number of the page that the key chain starts on.
+ * @param      isChainMultiple   The type of chain. Pass true for a multiple page chain.
+ * @param      key               Key to compare against. Null terminated at keySize.
+ * @param      keySize           Length of the key (without terminator).
+ *
+ * @return true if the chain holds exactly the key passed. false on read fault.
+ */
+static bool matchKey(PageNumber keyPage, bool isChainMultiple, const char* key, KVATSize keySize){
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
 
-KVATException KVATSaveValue(const char* key, const void* value, KVATSize valueSize){
-    if (!didInit || !key){return KVATException_invalidAccess;}
+    // Buffer to keep a single page
+    PageData singlePage[PAGESIZE/sizeof(PageData)];
 
-    // Get empty table entry for new, or existing for overwrite
-    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);   // Look for same key (overwrite)
-    bool isOverwrite = true;
-    if (tableEntryN==0){                            // Same key not found
-        tableEntryN = getEmptyTableEntryNumber();   // Get new entry
-        isOverwrite = false;
-    }
-    // Guard
-    if (tableEntryN==0){return KVATException_insufficientSpace;}
+    // Terminator is compared too, so a longer key in storage doesn't match
+    KVATSize compareSize = keySize+1;
+    KVATSize compared = 0;
+    PageNumber currentPageN = keyPage;
 
-    // Get table entry into a local variable. No need to read the entry's current value from storage if not overwriting -it's empty-
-    KVATKeyValueEntry tableEntry = {};
-    if (isOverwrite){
-        bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
-        if (!didReadEntry){return KVATException_tableError;}
+    for (PageNumber i = 0; currentPageN!=0 && i<index->pageCount; i++){
+        if (!readPage(singlePage, currentPageN, 0)){return false;}
+        currentPageN = isChainMultiple ? getNextPageNumberFromPage(singlePage) : 0;
+
+        KVATSize pageKeySize = compareSize-compared<pageDataSize ? compareSize-compared : pageDataSize;
+        if (memcmp((char*)singlePage+pageNextSize, key+compared, pageKeySize)!=0){return false;}
+
+        compared += pageKeySize;
+        if (compared==compareSize){return true;}
     }
 
-    // Set is as open and save with that status
-    tableEntry.metadata |= MOPEN;   // All that matters is that it's open, but keep old stuff in case of overwrite
-    bool didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
-    if (!didSaveEntry){return KVATException_tableError;}
+    return false;
+}
 
-    bool keySavedInMultipleChain, valueSavedInMultipleChain;
-    KVATSize valueRemains;
+/**
+ * Looks for the entry that holds a key exactly, with its length already known. Doesn't allocate.
+ *
+ * @param       key           String tag to look for. Null terminated at keySize.
+ * @param       keySize       Length of the key (without terminator).
+ *
+ * @return Number of the entry that matched the key, or 0.
+ */
+static PageNumber lookupKey(const char* key, KVATSize keySize){
+    KVATKeyValueEntry entry;
 
-    // Try to save the key if it's not an overwrite
-    if (!isOverwrite){
-        PageNumber keyStartPage = writeData((ConstPageDataRef)key, strlen(key)+1, 0, NULL, &keySavedInMultipleChain, NULL);
-        // Guard
-        if (keyStartPage==0){return KVATException_insufficientSpace;}
-        // Save start page
-        tableEntry.keyPage = keyStartPage;
+    for (PageNumber entryN = 1; entryN<index->pageCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){break;}
+
+        if ((entry.metadata & MACTIVE) && matchKey(entry.keyPage, entry.metadata & MKC_ISMULTIPLE, key, keySize)){
+            return entryN;
+        }
     }
 
-    // Prepare overwrite variables (if needed)
-    PageNumber overwriteChainStart = isOverwrite ? tableEntry.valuePage : 0; // The start page of the old chain
-    bool isOverwriteChainMultiple = tableEntry.metadata & MVC_ISMULTIPLE;
+    return 0;
+}
 
-    // Try to save the data (value)
-    PageNumber valueStartPage = writeData((ConstPageDataRef)value, valueSize, overwriteChainStart, isOverwriteChainMultiple, &valueSavedInMultipleChain, &valueRemains);
-    // Guard
-    if (valueStartPage==0){return KVATException_insufficientSpace;}
-    // Save start page
-    tableEntry.valuePage = valueStartPage;
+//////////////////////////////////////////////////////////////////
+//  PATTERN MATCH
 
-    // Set right metadata.
-    if (isOverwrite){
-        tableEntry.metadata &= MKC_ISMULTIPLE;   // Only keep previous key settings
-    }else{
-        tableEntry.metadata = keySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE; // Reset previous contents with new key settings
-    }
-    tableEntry.metadata |= MACTIVE | (valueSavedInMultipleChain ? MVC_MULTIPLE : MVC_SINGLE) | MKF_STRING;
+/* Patterns are matched with a set of states (positions in the pattern) that advances one key character at a time.
+ * This allows matching against key pages as they are read, and stopping as soon as no state is left.
+ *
+ * ?    Any single character but '/'
+ * *    Any run of characters but '/'
+ * **   Any run of characters
+ */
 
-    // Save remains
-    tableEntry.remains = valueRemains;
+typedef uint64_t PatternStates;     // Bit i set: pattern position i is a live state
 
-    // Save entry to storage
-    didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
-    if (!didSaveEntry){deinit(); return KVATException_tableError;}  // If saveTableEntry fails at this point, it can be fatal. de-initialize.
+#define PATTERNMAXLEN 63            // Longest pattern supported by PatternStates (one state per position, plus end)
 
-    return KVATException_none;
+/**
+ * Extends a set of states with the positions reachable without consuming a character (skipping stars).
+ *
+ * @param      pattern       Pattern being matched.
+ * @param      states        Current states.
+ *
+ * @return Closed set of states.
+ */
+static PatternStates closePatternStates(const char* pattern, PatternStates states){
+    for (KVATSize patternI = 0; pattern[patternI]!='\0'; patternI++){
+        if ((states & ((PatternStates)1<<patternI)) && pattern[patternI]=='*'){
+            KVATSize skipTo = pattern[patternI+1]=='*' ? patternI+2 : patternI+1;
+            states |= (PatternStates)1<<skipTo;
+        }
+    }
+    return states;
 }
 
 /**
- * Saves a string of data tagged with a key. KVATSaveValue convenience.
+ * Advances a set of states by one key character.
  *
- * @param      key            String tag for the value to save
- * @param      value          Reference to string to save
+ * @param      pattern       Pattern being matched.
+ * @param      states        Current (closed) states.
+ * @param      c             Character from the key.
  *
- * @return KVATException_ ... See KVATSaveValue
+ * @return Next (closed) set of states. 0 if the key can no longer match.
  */
-KVATException KVATSaveString(const char* key, const char* value){
-    return KVATSaveValue(key, value, strlen(value)+1); // Add 1 to length to save null terminator
+static PatternStates stepPatternStates(const char* pattern, PatternStates states, char c){
+    PatternStates nextStates = 0;
+
+    for (KVATSize patternI = 0; pattern[patternI]!='\0'; patternI++){
+        if (!(states & ((PatternStates)1<<patternI))){continue;}
+
+        char patternC = pattern[patternI];
+        if (patternC=='*'){
+            bool isDouble = pattern[patternI+1]=='*';
+            if (isDouble || c!='/'){
+                nextStates |= (PatternStates)1<<patternI;   // Star keeps consuming
+            }
+            if (isDouble){patternI++;}  // Skip second star of the pair
+        }else if ((patternC=='?' && c!='/') || patternC==c){
+            nextStates |= (PatternStates)1<<(patternI+1);
+        }
+    }
+
+    return closePatternStates(pattern, nextStates);
 }
 
-//////////////////////////////////////////////////////////////////
-//  PUBLIC RETRIEVE
+/**
+ * Matches a key chain against a pattern, reading key pages one at a time. Stops reading as soon as the key can't match.
+ *
+ * @param      keyPage            The number of the page that the key chain starts on.
+ * @param      isChainMultiple    The type of chain. Pass true for a multiple page chain.
+ * @param      pattern            Pattern to match.
+ * @param      patternLength      Length of pattern.
+ * @param      pageBuffer         Buffer that can hold a page.
+ *
+ * @return true if the whole key matches the pattern. false on read fault.
+ */
+static bool matchKeyChain(PageNumber keyPage, bool isChainMultiple, const char* pattern, KVATSize patternLength, PageDataRef pageBuffer){
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = PAGESIZE-pageNextSize;
 
-KVATException KVATRetrieveValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
-    // Assert
-    if (!didInit || !key){return KVATException_invalidAccess;}
+    PatternStates states = closePatternStates(pattern, 1);
+    PageNumber currentPageN = keyPage;
 
-    // Reset inout return
-    if (retrievePointerRef!=NULL){
-        *retrievePointerRef = NULL;
-    }
+    for (PageNumber i = 0; currentPageN!=0 && i<index->pageCount; i++){
+        if (!readPage(pageBuffer, currentPageN, 0)){return false;}
+        currentPageN = isChainMultiple ? getNextPageNumberFromPage(pageBuffer) : 0;
 
-    // Look for this thing
-    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);   // Look for same string. See if we need to overwrite.
-    if (tableEntryN==0){return KVATException_notFound;}
+        const char* keyData = (const char*)pageBuffer+pageNextSize;
+        for (KVATSize dataI = 0; dataI<pageDataSize; dataI++){
+            if (keyData[dataI]=='\0'){
+                // End of key. Match if pattern end was reached.
+                return (states & ((PatternStates)1<<patternLength)) ? true : false;
+            }
+
+            states = stepPatternStates(pattern, states, keyData[dataI]);
+            if (!states){return false;}
+        }
+    }
+
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////
+//  KEY COUNT
+
+// Prefix registered for key counting
+typedef struct PrefixCounter{
+    char* prefix;       // Copy of the prefix (heap). NULL if slot is free.
+    KVATSize length;
+    KVATSize count;
+}PrefixCounter;
+
+static PrefixCounter prefixCounters[PREFIXCOUNTERMAX];
+
+/**
+ * Counts the active keys that begin with a prefix. Single pass over the table.
+ *
+ * @param      prefix        Beginning of the keys to count.
+ *
+ * @return Number of keys found.
+ */
+static KVATSize countKeysWithPrefix(const char* prefix){
+    KVATSize count = 0;
+    PageNumber entryN = 1;
+
+    while ((entryN = lookupByKey(prefix, true, entryN, NULL, 0))){
+        count++;
+        entryN++;
+    }
+
+    return count;
+}
+
+/**
+ * Recounts the keys of every registered prefix. Call after the table changes outside of save, rename and delete.
+ */
+static void recountPrefixCounters(){
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        if (prefixCounters[counterI].prefix!=NULL){
+            prefixCounters[counterI].count = countKeysWithPrefix(prefixCounters[counterI].prefix);
+        }
+    }
+}
+
+/**
+ * Finds the registered prefixes a key begins with.
+ *
+ * @param      key           Key to match.
+ *
+ * @return Mask of the matching prefix counters (bit n for prefixCounters[n]).
+ */
+static uint8_t matchPrefixCounters(const char* key){
+    uint8_t counterMask = 0;
+
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        PrefixCounter* counter = &prefixCounters[counterI];
+        if (counter->prefix!=NULL && strncmp(key, counter->prefix, counter->length)==0){
+            counterMask |= 1<<counterI;
+        }
+    }
+
+    return counterMask;
+}
+
+/**
+ * Updates the key counts to reflect a key that was added or removed, with the prefixes it matched.
+ *
+ * @param      counterMask   Prefix counters the key matches (matchPrefixCounters).
+ * @param      isAdded       true if key was added.
+ */
+static void noteMatchedKeyCountChange(uint8_t counterMask, bool isAdded){
+    activeEntryCount += isAdded ? 1 : -1;
+
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        if (counterMask & (1<<counterI)){
+            prefixCounters[counterI].count += isAdded ? 1 : -1;
+        }
+    }
+}
+
+/**
+ * Updates the key counts to reflect a key that was added or removed.
+ *
+ * @param      key           Key added or removed.
+ * @param      isAdded       true if key was added.
+ */
+static void noteKeyCountChange(const char* key, bool isAdded){
+    noteMatchedKeyCountChange(matchPrefixCounters(key), isAdded);
+}
+
+//////////////////////////////////////////////////////////////////
+//  CHANGE NOTIFICATION
+
+// Subscription to changes on a key or prefix
+typedef struct Subscription{
+    char* key;                      // Copy of the key or prefix (heap). NULL if slot is free.
+    KVATSize length;
+    bool isPrefix;
+    KVATChangeCallback callback;
+    void* context;
+}Subscription;
+
+static Subscription subscriptions[SUBSCRIPTIONMAX];
+static KVATSize subscriptionCount = 0;
+
+/**
+ * Calls the subscriptions that cover a key. Call only after the change is committed to storage.
+ *
+ * @param      key           Key that changed.
+ * @param      event         What happened to the key.
+ * @param      size          Size of the value after the change (0 if there is none).
+ */
+static void notifySubscribers(const char* key, KVATEvent event, KVATSize size){
+    if (subscriptionCount==0){return;}
+
+    for (KVATSize subscriptionI = 0; subscriptionI<SUBSCRIPTIONMAX; subscriptionI++){
+        Subscription* subscription = &subscriptions[subscriptionI];
+        if (subscription->key==NULL){continue;}
+
+        bool isCovered = subscription->isPrefix ? strncmp(key, subscription->key, subscription->length)==0
+                                                : strcmp(key, subscription->key)==0;
+        if (isCovered){
+            subscription->callback(key, event, size, subscription->context);
+        }
+    }
+}
+
+/**
+ * Calls the subscriptions that cover the key of an entry. The key is only fetched if there are subscriptions.
+ *
+ * @param      entry         Reference to the entry that changed.
+ * @param      event         What happened to the key.
+ * @param      size          Size of the value after the change (0 if there is none).
+ */
+static void notifySubscribersOfEntry(KVATKeyValueEntry* entry, KVATEvent event, KVATSize size){
+    if (subscriptionCount==0){return;}
+
+    char entryKeyPreallocBuff[STRINGKEYSTDLEN];
+    char* entryKey = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, (PageDataRef)entryKeyPreallocBuff, STRINGKEYSTDLEN, false);
+    if (entryKey==NULL){return;}
+
+    notifySubscribers(entryKey, event, size);
+
+    if (entryKey != entryKeyPreallocBuff){
+        free(entryKey);
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+//  TIERING
+
+/**
+ * Marks an entry as just used, for cold value detection (KVATTierService) and eviction.
+ *
+ * @param      tableEntryN    Entry used.
+ * @param      isRead         true on a read. Only reads spare an entry from eviction; a value just saved has yet to prove hot.
+ */
+static void noteEntryAccess(PageNumber tableEntryN, bool isRead){
+    if (entryLastAccess!=NULL){
+        entryLastAccess[tableEntryN] = ++tierOperation;
+    }
+    if (entryReferenced!=NULL && isRead){
+        entryReferenced[tableEntryN/8] |= 1<<(tableEntryN%8);
+    }
+}
+
+static bool isEntryTiered(KVATKeyValueEntry* entry){
+    return (entry->metadata & MVALUEFORMAT)==MVF_TIERED;
+}
+
+/**
+ * Builds the key a value is kept under in the tier: its key after TIERKEYPREFIX. Keys saved in the tier's
+ * store directly (KVATLogSaveValue, KVATMove) then never meet tiered values.
+ *
+ * @return Allocated tier key. NULL on heap error.
+ */
+static char* makeTierKey(const char* key){
+    size_t keyLength = strlen(key);
+    char* tierKey = (char*)malloc(sizeof(TIERKEYPREFIX)+keyLength);
+    if (tierKey==NULL){return NULL;}
+
+    memcpy(tierKey, TIERKEYPREFIX, sizeof(TIERKEYPREFIX)-1);
+    memcpy(tierKey+sizeof(TIERKEYPREFIX)-1, key, keyLength+1);
+
+    return tierKey;
+}
+
+/**
+ * Reads a tiered value from the tier. Same modes as KVATRetrieveValue.
+ *
+ * @return KVATException_ (notMapped) (heapError) ... See KVATTier retrieve
+ *         notMapped if no tier is set.
+ */
+static KVATException retrieveTieredValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    if (tier==NULL){return KVATException_notMapped;}
+
+    char* tierKey = makeTierKey(key);
+    if (tierKey==NULL){return KVATException_heapError;}
+
+    KVATException exception = tier->retrieve(tierKey, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+    free(tierKey);
+
+    return exception;
+}
+
+/**
+ * Opens a write of a value into the tier, under its tier key.
+ *
+ * @return KVATException_ (heapError) ... See KVATTier writeOpen
+ */
+static KVATException openTieredValueWrite(const char* key, KVATSize size){
+    char* tierKey = makeTierKey(key);
+    if (tierKey==NULL){return KVATException_heapError;}
+
+    KVATException exception = tier->writeOpen(tierKey, size);
+    free(tierKey);
+
+    return exception;
+}
+
+/**
+ * Removes a value from the tier (after no entry points to it).
+ */
+static void removeTieredValue(const char* key){
+    if (tier==NULL){return;}
+
+    char* tierKey = makeTierKey(key);
+    if (tierKey==NULL){return;}
+
+    tier->remove(tierKey);
+    free(tierKey);
+}
+
+/**
+ * Compares the value of an entry against data in memory. Tiered values are read from the tier whole.
+ *
+ * @return true if the entry holds exactly the data passed.
+ */
+static bool compareEntryValue(const char* key, KVATKeyValueEntry* entry, const void* data, KVATSize size){
+    if (!isEntryTiered(entry)){
+        return compareData(entry->valuePage, entry->metadata & MVC_ISMULTIPLE, entry->remains, data, size);
+    }
+
+    void* stored;
+    KVATSize storedSize;
+    if (retrieveTieredValue(key, NULL, 0, &stored, &storedSize)!=KVATException_none){return false;}
+
+    bool isEqual = storedSize==size && memcmp(stored, data, size)==0;
+    free(stored);
+
+    return isEqual;
+}
+
+/**
+ * Passes a piece of a value to the tier's open stream (KVATExportWriter).
+ */
+static bool writeTierChunk(const void* data, KVATSize size, void* context){
+    return tier->writeChunk(data, size)==KVATException_none;
+}
+
+/**
+ * Removes the tiered value of an entry from the tier (after the entry no longer points to it).
+ */
+static void removeTieredValueOfEntry(KVATKeyValueEntry* entry){
+    if (tier==NULL){return;}
+
+    char* key = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, NULL, 0, false);
+    if (key==NULL){return;}
+
+    removeTieredValue(key);
+    free(key);
+}
+
+/**
+ * Moves the value of an entry to the tier, and leaves a stub in its place. The value is streamed a page at a time.
+ * The value doesn't change, so there is no new sequence and no notification.
+ *
+ * @param      entry          Reference to an active raw entry (updated).
+ * @param      tableEntryN    Position of the entry in the table.
+ *
+ * @return KVATException_ (fetchFault) (insufficientSpace) (tableError) ... See KVATTier
+ */
+static KVATException moveEntryToTier(KVATKeyValueEntry* entry, PageNumber tableEntryN){
+    char* key = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, NULL, 0, false);
+    if (key==NULL){return KVATException_fetchFault;}
+
+    KVATSize size = getEntryValueSize(entry);
+    if (size==0){free(key); return KVATException_fetchFault;}
+
+    // Value is committed in the tier first
+    KVATException exception = openTieredValueWrite(key, size);
+    if (exception==KVATException_none){
+        exception = streamData(entry->valuePage, entry->metadata & MVC_ISMULTIPLE, entry->remains, &writeTierChunk, NULL);
+        if (exception==KVATException_none){
+            exception = tier->writeClose();
+        }else{
+            tier->writeAbort();
+        }
+    }
+    if (exception!=KVATException_none){free(key); return exception;}
+
+    // Then the stub, in a new chain, so the entry holds either the old value or the stub
+    bool isStubMultiple;
+    KVATSize stubRemains;
+    KVATException writeFailure;
+    PageNumber stubPage = writeData((ConstPageDataRef)&size, sizeof(KVATSize), 0, false, &isStubMultiple, &stubRemains, &writeFailure);
+    if (stubPage==0){
+        exception = writeFailure;
+    }else{
+        PageNumber oldValuePage = entry->valuePage;
+        bool isOldValueMultiple = entry->metadata & MVC_ISMULTIPLE;
+
+        entry->valuePage = stubPage;
+        entry->remains = stubRemains;
+        setEntryMetadata(entry, MVC_ISMULTIPLE | MVALUEFORMAT, (isStubMultiple ? MVC_MULTIPLE : MVC_SINGLE) | MVF_TIERED);
+
+        if (saveTableEntry(entry, tableEntryN)){
+            followPageChainAndSetPageRecord(oldValuePage, false, isOldValueMultiple);
+        }else{
+            followPageChainAndSetPageRecord(stubPage, false, isStubMultiple);
+            exception = KVATException_tableError;
+        }
+    }
+
+    // Tier copy is not referenced if the stub didn't make it
+    if (exception!=KVATException_none){
+        removeTieredValue(key);
+    }
+
+    free(key);
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC SAVE
+
+/**
+ * Saves data tagged with a key into a table entry already looked up by the caller.
+ *
+ * @param      key            String tag for the value to save
+ * @param      tableEntryN    Entry currently holding the key (overwrite), or 0 to use a new entry.
+ * @param      value          Reference to value to save in storage
+ * @param      valueSize      Length of the value to save
+ * @param      valueFormat    Value format portion of the metadata (MVF_) to set on the entry.
+ * @param[out] savedEntryN    Optional: Entry the value was saved in.
+ *
+ * @return KVATException_ (insufficientSpace) (fetchFault) (storageFault) (tableError) (none)
+ */
+static KVATException saveValueInEntry(const char* key, PageNumber tableEntryN, const void* value, KVATSize valueSize, MetaData valueFormat, PageNumber* savedEntryN){
+    bool isOverwrite = true;
+    if (tableEntryN==0){                            // Same key not found
+        tableEntryN = getEmptyTableEntryNumber();   // Get new entry
+        isOverwrite = false;
+    }
+    // Guard
+    if (tableEntryN==0){return KVATException_insufficientSpace;}
+
+    // Get table entry into a local variable. No need to read the entry's current value from storage if not overwriting -it's empty-
+    KVATKeyValueEntry tableEntry = {};
+    if (isOverwrite){
+        bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
+        if (!didReadEntry){return KVATException_tableError;}
+    }
+
+    // Set is as open and save with that status
+    tableEntry.metadata |= MOPEN;   // All that matters is that it's open, but keep old stuff in case of overwrite
+    bool didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
+    if (!didSaveEntry){return KVATException_tableError;}
+
+    bool keySavedInMultipleChain, valueSavedInMultipleChain;
+    KVATSize valueRemains;
+    KVATException writeFailure;
+
+    // Try to save the key if it's not an overwrite
+    if (!isOverwrite){
+        PageNumber keyStartPage = writeData((ConstPageDataRef)key, strlen(key)+1, 0, NULL, &keySavedInMultipleChain, NULL, &writeFailure);
+        // Guard
+        if (keyStartPage==0){return writeFailure;}
+        // Save start page
+        tableEntry.keyPage = keyStartPage;
+    }
+
+    // Prepare overwrite variables (if needed)
+    PageNumber overwriteChainStart = isOverwrite ? tableEntry.valuePage : 0; // The start page of the old chain
+    bool isOverwriteChainMultiple = tableEntry.metadata & MVC_ISMULTIPLE;
+
+    // Try to save the data (value)
+    PageNumber valueStartPage = writeData((ConstPageDataRef)value, valueSize, overwriteChainStart, isOverwriteChainMultiple, &valueSavedInMultipleChain, &valueRemains, &writeFailure);
+    // Guard
+    if (valueStartPage==0){
+        // A new entry gives back its key and goes back to empty
+        if (!isOverwrite){
+            followPageChainAndSetPageRecord(tableEntry.keyPage, false, keySavedInMultipleChain);
+            KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+            saveTableEntry(&emptyEntry, tableEntryN);
+        }
+        return writeFailure;
+    }
+    // Save start page
+    tableEntry.valuePage = valueStartPage;
+
+    // Set right metadata.
+    if (isOverwrite){
+        tableEntry.metadata &= MKC_ISMULTIPLE;   // Only keep previous key settings
+    }else{
+        tableEntry.metadata = keySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE; // Reset previous contents with new key settings
+    }
+    tableEntry.metadata |= MACTIVE | (valueSavedInMultipleChain ? MVC_MULTIPLE : MVC_SINGLE) | MKF_STRING | (valueFormat & MVALUEFORMAT);
+
+    // Save remains
+    tableEntry.remains = valueRemains;
+
+#if CHANGELOG
+    tableEntry.sequence = ++storeSequence;
+#endif
+
+    // Save entry to storage
+    didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
+    if (!didSaveEntry){deinit(); return KVATException_tableError;}  // If saveTableEntry fails at this point, it can be fatal. de-initialize.
+
+    if (!isOverwrite){
+        noteKeyCountChange(key, true);
+    }
+
+    // A tiered value is saved as its stub
+    KVATSize notifiedSize = valueSize;
+    if ((valueFormat & MVALUEFORMAT)==MVF_TIERED){
+        memcpy(&notifiedSize, value, sizeof(KVATSize));
+    }
+    notifySubscribers(key, KVATEvent_save, notifiedSize);
+
+    if (savedEntryN!=NULL){
+        *savedEntryN = tableEntryN;
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Saves a value into a table entry already looked up by the caller. Raw values go in storage or in the tier
+ * as the tier's size threshold says. Evictable values always stay in storage.
+ *
+ * @param      valueFormat    MVF_RAW or MVF_EVICTABLE.
+ *
+ * @return KVATException_ ... See saveValueInEntry and KVATTier
+ */
+static KVATException saveValue(const char* key, PageNumber tableEntryN, const void* value, KVATSize valueSize, MetaData valueFormat){
+    bool wasTiered = false;
+    if (tier!=NULL && tableEntryN){
+        KVATKeyValueEntry tableEntry;
+        if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+        wasTiered = isEntryTiered(&tableEntry);
+    }
+
+    KVATException exception;
+    PageNumber savedEntryN = 0;
+
+    if (valueFormat==MVF_RAW && tier!=NULL && tier->sizeThreshold && valueSize>tier->sizeThreshold){
+        // Value goes to the tier first, then its stub
+        exception = openTieredValueWrite(key, valueSize);
+        if (exception==KVATException_none){
+            exception = tier->writeChunk(value, valueSize);
+            if (exception==KVATException_none){
+                exception = tier->writeClose();
+            }else{
+                tier->writeAbort();
+            }
+        }
+
+        if (exception==KVATException_none){
+            exception = saveValueInEntry(key, tableEntryN, &valueSize, sizeof(KVATSize), MVF_TIERED, &savedEntryN);
+            if (exception!=KVATException_none && !wasTiered){
+                removeTieredValue(key);
+            }
+        }
+    }else{
+        exception = saveValueInEntry(key, tableEntryN, value, valueSize, valueFormat, &savedEntryN);
+
+        // Tier copy is no longer referenced
+        if (exception==KVATException_none && wasTiered){
+            removeTieredValue(key);
+        }
+    }
+
+    if (exception==KVATException_none){
+        noteEntryAccess(savedEntryN, false);
+    }
+
+    return exception;
+}
+
+KVATException KVATSaveValue(const char* key, const void* value, KVATSize valueSize){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    // Look for same key (overwrite)
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    return saveValue(key, tableEntryN, value, valueSize, MVF_RAW);
+}
+
+KVATException KVATSaveValueWithKey(const KVATKey* key, const void* value, KVATSize valueSize){
+    if (!didInit || !key || !key->string){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupKey(key->string, key->length);
+
+    return saveValue(key->string, tableEntryN, value, valueSize, MVF_RAW);
+}
+
+KVATException KVATSaveEvictable(const char* key, const void* value, KVATSize valueSize){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    return saveValue(key, tableEntryN, value, valueSize, MVF_EVICTABLE);
+}
+
+KVATException KVATSaveIfChanged(const char* key, const void* value, KVATSize valueSize, bool* didSave){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    if (didSave!=NULL){
+        *didSave = false;
+    }
+
+    // Single lookup serves both the comparison and the save
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    if (tableEntryN){
+        KVATKeyValueEntry tableEntry;
+        if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+        // Nothing to program if stored value is the same
+        if (compareEntryValue(key, &tableEntry, value, valueSize)){
+            return KVATException_none;
+        }
+    }
+
+    KVATException saveException = saveValue(key, tableEntryN, value, valueSize, MVF_RAW);
+    if (saveException==KVATException_none && didSave!=NULL){
+        *didSave = true;
+    }
+
+    return saveException;
+}
+
+KVATException KVATCompareAndSave(const char* key, const void* expectedValue, KVATSize expectedSize, const void* value, KVATSize valueSize){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    if (expectedValue==NULL){
+        // Expecting key not to exist yet
+        if (tableEntryN){return KVATException_compareMismatch;}
+
+    }else{
+        if (tableEntryN==0){return KVATException_notFound;}
+
+        KVATKeyValueEntry tableEntry;
+        if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+        if (!compareEntryValue(key, &tableEntry, expectedValue, expectedSize)){
+            return KVATException_compareMismatch;
+        }
+    }
+
+    return saveValue(key, tableEntryN, value, valueSize, MVF_RAW);
+}
+
+/**
+ * Saves a string of data tagged with a key. KVATSaveValue convenience.
+ *
+ * @param      key            String tag for the value to save
+ * @param      value          Reference to string to save
+ *
+ * @return KVATException_ ... See KVATSaveValue
+ */
+KVATException KVATSaveString(const char* key, const char* value){
+    return KVATSaveValue(key, value, strlen(value)+1); // Add 1 to length to save null terminator
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC COUNTERS
+
+/**
+ * Returns the number of word slots a counter rotates through. A counter takes up a single page.
+ *
+ * @return Number of slots.
+ */
+static KVATSize getCounterSlotCount(){
+    return PAGESIZE/sizeof(KVATCounter);
+}
+
+/**
+ * Checks that a handle still refers to a live counter. Costs a single table entry read, no lookup.
+ *
+ * @param      handle         Reference to handle to validate
+ *
+ * @return true if valid.
+ */
+static bool validateCounterHandle(const KVATCounterHandle* handle){
+    if (handle==NULL || handle->entry==0 || handle->entry>=index->pageCount){return false;}
+
+    KVATKeyValueEntry tableEntry;
+    if (!readTableEntry(&tableEntry, handle->entry)){return false;}
+
+    return (tableEntry.metadata & MACTIVE)
+            && (tableEntry.metadata & MVALUEFORMAT)==MVF_COUNTER
+            && tableEntry.valuePage==handle->page;
+}
+
+/**
+ * Reads the slots of a counter and finds the current one (holds the greatest count).
+ *
+ * @param      page           Page holding the counter slots.
+ * @param[out] count          Current count.
+ * @param[out] currentSlotRef Optional: Position of the current slot.
+ *
+ * @return Boolean with success of the read.
+ */
+static bool readCounterSlots(PageNumber page, KVATCounter* count, KVATSize* currentSlotRef){
+    KVATSize slotCount = getCounterSlotCount();
+
+    PageData slots[PAGESIZE/sizeof(PageData)];
+    if (!readPage(slots, page, 0)){return false;}
+
+    KVATSize currentSlot = 0;
+    for (KVATSize slotI = 1; slotI<slotCount; slotI++){
+        if (slots[slotI]>slots[currentSlot]){
+            currentSlot = slotI;
+        }
+    }
+
+    *count = slots[currentSlot];
+
+    if (currentSlotRef!=NULL){
+        *currentSlotRef = currentSlot;
+    }
+
+    return true;
+}
+
+KVATException KVATCounterOpen(const char* key, KVATCounterHandle* handle){
+    if (!didInit || !key || !handle){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    if (tableEntryN==0){
+        // New counter. Start with all slots at 0
+        PageData slots[PAGESIZE/sizeof(PageData)] = {0};
+
+        KVATException saveException = saveValueInEntry(key, 0, slots, PAGESIZE, MVF_COUNTER, &tableEntryN);
+        if (saveException!=KVATException_none){return saveException;}
+    }
+
+    KVATKeyValueEntry tableEntry;
+    if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+    // Key is being used for something else
+    if ((tableEntry.metadata & MVALUEFORMAT)!=MVF_COUNTER){return KVATException_invalidAccess;}
+
+    handle->entry = tableEntryN;
+    handle->page = tableEntry.valuePage;
+
+    return KVATException_none;
+}
+
+KVATException KVATCounterAddByHandle(const KVATCounterHandle* handle, KVATCounter delta, KVATCounter* newCount){
+    if (!didInit || !validateCounterHandle(handle)){return KVATException_invalidAccess;}
+
+    KVATCounter count;
+    KVATSize currentSlot;
+    if (!readCounterSlots(handle->page, &count, &currentSlot)){return KVATException_fetchFault;}
+    KVATSize slotCount = getCounterSlotCount();
+
+    // Saturate instead of wrapping (greatest slot marks the current one)
+    count = (count+delta<count) ? UINT32_MAX : count+delta;
+
+    // Single word program into the next slot
+    KVATSize nextSlot = (currentSlot+1)%slotCount;
+    if (!writePageSegment(&count, handle->page, nextSlot*sizeof(KVATCounter), sizeof(KVATCounter))){return KVATException_storageFault;}
+
+    if (newCount!=NULL){
+        *newCount = count;
+    }
+
+    if (subscriptionCount){
+        KVATKeyValueEntry tableEntry;
+        if (readTableEntry(&tableEntry, handle->entry)){
+            notifySubscribersOfEntry(&tableEntry, KVATEvent_save, PAGESIZE);
+        }
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATCounterGetByHandle(const KVATCounterHandle* handle, KVATCounter* count){
+    if (!didInit || !count || !validateCounterHandle(handle)){return KVATException_invalidAccess;}
+
+    return readCounterSlots(handle->page, count, NULL) ? KVATException_none : KVATException_fetchFault;
+}
+
+KVATException KVATCounterAdd(const char* key, KVATCounter delta, KVATCounter* newCount){
+    KVATCounterHandle handle;
+
+    KVATException openException = KVATCounterOpen(key, &handle);
+    if (openException!=KVATException_none){return openException;}
+
+    return KVATCounterAddByHandle(&handle, delta, newCount);
+}
+
+KVATException KVATCounterGet(const char* key, KVATCounter* count){
+    if (!didInit || !key || !count){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+    if (tableEntryN==0){return KVATException_notFound;}
+
+    KVATKeyValueEntry tableEntry;
+    if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+    if ((tableEntry.metadata & MVALUEFORMAT)!=MVF_COUNTER){return KVATException_invalidAccess;}
+
+    return readCounterSlots(tableEntry.valuePage, count, NULL) ? KVATException_none : KVATException_fetchFault;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC STREAMING WRITE
+
+static ChainWriter streamWriter;            // Value chain being written by the open stream
+static KVATKeyValueEntry streamEntry;       // Entry as it will be committed on close
+static PageNumber streamEntryN = 0;         // Entry being written by the open stream. 0 when no stream is open.
+static bool streamIsOverwrite = false;
+static char* streamKey = NULL;              // Copy of the key of the open stream (heap)
+
+/**
+ * Marks the stream as closed and frees its key copy.
+ */
+static void releaseStream(){
+    free(streamKey);
+    streamKey = NULL;
+    streamEntryN = 0;
+}
+
+/**
+ * Releases everything held by the open stream. Leaves the entry as it was before the stream was opened.
+ */
+static void discardStream(){
+    abortChainWrite(&streamWriter);
+
+    if (!streamIsOverwrite){
+        // Return key pages and free the reserved entry
+        followPageChainAndSetPageRecord(streamEntry.keyPage, false, streamEntry.metadata & MKC_ISMULTIPLE);
+        KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+        saveTableEntry(&emptyEntry, streamEntryN);
+    }
+
+    releaseStream();
+}
+
+KVATException KVATWriteOpen(const char* key, KVATSize expectedSize){
+    if (!didInit || !key || expectedSize==0 || streamEntryN){return KVATException_invalidAccess;}
+
+    // Get empty table entry for new, or existing for overwrite
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+    streamIsOverwrite = true;
+    if (tableEntryN==0){
+        tableEntryN = getEmptyTableEntryNumber();
+        streamIsOverwrite = false;
+    }
+    if (tableEntryN==0){return KVATException_insufficientSpace;}
+
+    KVATSize keySize = strlen(key)+1;
+    streamKey = malloc(keySize);
+    if (streamKey==NULL){return KVATException_heapError;}
+    memcpy(streamKey, key, keySize);
+
+    streamWriter.pageData = NULL;
+    memset(&streamEntry, 0, sizeof(KVATKeyValueEntry));
+    if (streamIsOverwrite){
+        // Existing value stays untouched until close
+        if (!readTableEntry(&streamEntry, tableEntryN)){releaseStream(); return KVATException_tableError;}
+    }else{
+        // Reserve entry
+        streamEntry.metadata = MOPEN;
+        if (!saveTableEntry(&streamEntry, tableEntryN)){releaseStream(); return KVATException_tableError;}
+    }
+    streamEntryN = tableEntryN;
+
+    // New entries get their key right away
+    if (!streamIsOverwrite){
+        bool keySavedInMultipleChain;
+        KVATException writeFailure;
+        streamEntry.keyPage = writeData((ConstPageDataRef)key, keySize, 0, NULL, &keySavedInMultipleChain, NULL, &writeFailure);
+        if (streamEntry.keyPage==0){discardStream(); return writeFailure;}
+        setEntryMetadata(&streamEntry, MKC_ISMULTIPLE, keySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE);
+    }
+
+    // Value always goes into a new chain so the old one stays valid until commit
+    if (!beginChainWrite(&streamWriter, expectedSize)){
+        discardStream();
+        return KVATException_insufficientSpace;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATWriteChunk(const void* chunk, KVATSize chunkSize){
+    if (!didInit || !streamEntryN || (chunk==NULL && chunkSize)){return KVATException_invalidAccess;}
+
+    if (streamWriter.writtenSize+chunkSize > streamWriter.expectedSize){return KVATException_invalidAccess;}
+
+    if (!appendChainWrite(&streamWriter, chunk, chunkSize)){
+        discardStream();
+        return KVATException_insufficientSpace;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATWriteClose(){
+    if (!didInit || !streamEntryN){return KVATException_invalidAccess;}
+
+    // Stream must be complete to commit
+    if (streamWriter.writtenSize!=streamWriter.expectedSize){
+        discardStream();
+        return KVATException_invalidAccess;
+    }
+
+    // Overwritten entry must not have changed under the stream
+    KVATKeyValueEntry currentEntry;
+    if (streamIsOverwrite){
+        if (!readTableEntry(&currentEntry, streamEntryN)){discardStream(); return KVATException_tableError;}
+        if (!(currentEntry.metadata & MACTIVE) || currentEntry.keyPage!=streamEntry.keyPage){
+            discardStream();
+            return KVATException_notFound;
+        }
+    }
+
+    bool isValueMultiple = streamWriter.isMultipleChain;
+    KVATSize valueRemains;
+    PageNumber valueStartPage = endChainWrite(&streamWriter, &valueRemains);
+    if (valueStartPage==0){discardStream(); return KVATException_storageFault;}
+
+    // Single commit of the entry
+    PageNumber oldValuePage = streamEntry.valuePage;
+    bool isOldValueMultiple = streamEntry.metadata & MVC_ISMULTIPLE;
+    bool wasTiered = streamIsOverwrite && isEntryTiered(&streamEntry);
+
+    streamEntry.metadata &= MKC_ISMULTIPLE;
+    streamEntry.metadata |= MACTIVE | (isValueMultiple ? MVC_MULTIPLE : MVC_SINGLE) | MKF_STRING;
+    streamEntry.valuePage = valueStartPage;
+    streamEntry.remains = valueRemains;
+#if CHANGELOG
+    streamEntry.sequence = ++storeSequence;
+#endif
+
+    PageNumber tableEntryN = streamEntryN;
+
+    if (!saveTableEntry(&streamEntry, tableEntryN)){releaseStream(); deinit(); return KVATException_tableError;}   // Fatal, as in KVATSaveValue
+
+    // Old value is no longer referenced
+    if (streamIsOverwrite){
+        followPageChainAndSetPageRecord(oldValuePage, false, isOldValueMultiple);
+        if (wasTiered){
+            removeTieredValue(streamKey);
+        }
+    }else{
+        noteKeyCountChange(streamKey, true);
+    }
+
+    notifySubscribers(streamKey, KVATEvent_save, streamWriter.expectedSize);
+
+    releaseStream();
+
+    return KVATException_none;
+}
+
+KVATException KVATWriteAbort(){
+    if (!didInit || !streamEntryN){return KVATException_invalidAccess;}
+
+    discardStream();
+
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  EVICTION
+
+// Approximate LRU (CLOCK): every read sets the entry's bit (noteEntryAccess). The hand goes around the table,
+// clearing set bits, and evicts the first evictable entry it finds clear. Values saved and never read go first.
+
+static bool isEntryReferenced(PageNumber tableEntryN){
+    return entryReferenced[tableEntryN/8] & 1<<(tableEntryN%8);
+}
+
+static bool seedEvictionClock(){
+    // Table size can change (KVATResize). Reallocate.
+    free(entryReferenced);
+    entryReferenced = malloc(getPageRecordSize()); // Permanent allocation
+    if (entryReferenced==NULL){return false;}
+    memset(entryReferenced, 0, getPageRecordSize());
+    evictionHand = 0;
+
+#if CHANGELOG
+    // Values saved in the newer half of the sequences start as referenced, so the older ones go first
+    uint32_t recentSequence = index->sequenceFloor + (storeSequence-index->sequenceFloor)/2;
+    KVATKeyValueEntry entry;
+
+    for (PageNumber entryN = 1; entryN<index->pageCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){return false;}
+
+        if ((entry.metadata & (MACTIVE | MVALUEFORMAT))==(MACTIVE | MVF_EVICTABLE) && entry.sequence>recentSequence){
+            entryReferenced[entryN/8] |= 1<<(entryN%8);
+        }
+    }
+#endif
+
+    return true;
+}
+
+/**
+ * Deletes an evictable entry to make room. Subscribers are told with KVATEvent_evict.
+ *
+ * @return true if the entry was evicted.
+ */
+static bool evictEntry(KVATKeyValueEntry* entry, PageNumber tableEntryN){
+    char* key = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, NULL, 0, false);
+    if (key==NULL){return false;}
+
+    MetaData formerMetadata = entry->metadata;
+    setEntryDeleted(entry);
+
+    bool didSaveEntry = saveTableEntry(entry, tableEntryN);
+    if (didSaveEntry){
+        releaseDeletedEntryPages(entry, formerMetadata);
+        noteKeyCountChange(key, false);
+        notifySubscribers(key, KVATEvent_evict, 0);
+    }
+
+    free(key);
+    return didSaveEntry;
+}
+
+static PageNumber evictColdestEntry(){
+    if (entryReferenced==NULL){return 0;}
+
+    KVATKeyValueEntry entry;
+
+    // Two turns: the first one may only clear bits
+    for (KVATSize stepI = 0; stepI<2*(KVATSize)(index->pageCount-1); stepI++){
+        if (++evictionHand>=index->pageCount){
+            evictionHand = 1;
+        }
+        PageNumber entryN = evictionHand;
+
+        // Entries being written are left alone
+        if (entryN==pinnedEntryN || entryN==streamEntryN){continue;}
+
+        if (!readTableEntry(&entry, entryN)){return 0;}
+        if ((entry.metadata & (MACTIVE | MOPEN | MVALUEFORMAT))!=(MACTIVE | MVF_EVICTABLE)){continue;}
+
+        if (isEntryReferenced(entryN)){
+            entryReferenced[entryN/8] &= ~(1<<(entryN%8));
+            continue;
+        }
+
+        return evictEntry(&entry, entryN) ? entryN : 0;
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+//  FROZEN STORE
+
+/**
+ * Looks for a key in the frozen store. Single bucket and entry read.
+ *
+ * @param      key           String key to look for.
+ * @param      keyHash       kvatFrozenHash(key, 0) if known (KVATKey), or 0 to compute it.
+ *
+ * @return Reference to the entry (in flash), or NULL if there is no frozen store or key is not in it.
+ */
+static const KVATFrozenEntry* lookupFrozen(const char* key, uint32_t keyHash){
+    if (frozenStore==NULL || frozenStore->entryCount==0){return NULL;}
+
+    if (keyHash==0){keyHash = kvatFrozenHash(key, 0);}
+    uint32_t bucket = keyHash % frozenStore->bucketCount;
+    const KVATFrozenEntry* entry = &frozenStore->entries[kvatFrozenHash(key, frozenStore->displacements[bucket]) % frozenStore->entryCount];
+
+    // Perfect hash gives an entry for any key. Confirm it.
+    return strcmp(entry->key, key)==0 ? entry : NULL;
+}
+
+/**
+ * Retrieves a value from the frozen store. Same modes as KVATRetrieveValue.
+ *
+ * @param      keyHash       See lookupFrozen.
+ *
+ * @return KVATException_ (notFound) (heapError) (none)
+ */
+static KVATException retrieveFrozenValue(const char* key, uint32_t keyHash, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    const KVATFrozenEntry* entry = lookupFrozen(key, keyHash);
+    if (entry==NULL){return KVATException_notFound;}
+
+    char* value = retrieveBuffer;
+    KVATSize copySize = entry->valueSize;
+
+    if (value!=NULL){
+        // Trim to buffer, null terminate if there is room
+        if (copySize>retrieveBufferSize){copySize = retrieveBufferSize;}
+        if (copySize<retrieveBufferSize){value[copySize] = '\0';}
+    }else{
+        // Extra null terminator, as fetchData
+        value = malloc(copySize+1);
+        if (value==NULL){return KVATException_heapError;}
+        value[copySize] = '\0';
+    }
+    memcpy(value, entry->value, copySize);
+
+    if (size!=NULL){
+        *size = entry->valueSize;
+    }
+
+    if (retrievePointerRef!=NULL){
+        *retrievePointerRef = value;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATSetFrozenStore(const KVATFrozenStore* store){
+    if (store!=NULL && store->entryCount && (store->bucketCount==0 || !store->displacements || !store->entries)){
+        return KVATException_invalidAccess;
+    }
+
+    frozenStore = store;
+
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC RETRIEVE
+
+/**
+ * Retrieves the value of a key already looked up by the caller, wherever it is kept. Same modes as KVATRetrieveValue,
+ * but size is the full size of the value, also if trimmed to the buffer.
+ *
+ * @param      tableEntryN    Entry holding the key, or 0 to fall back to the frozen store.
+ * @param      keyHash        See lookupFrozen.
+ *
+ * @return KVATException_ (notFound) (tableError) (fetchFault) (heapError) (none) ... See KVATTier retrieve
+ */
+static KVATException retrieveWholeValue(const char* key, uint32_t keyHash, PageNumber tableEntryN, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    // Reset inout return
+    if (retrievePointerRef!=NULL){
+        *retrievePointerRef = NULL;
+    }
+
+    if (tableEntryN==0){
+        // Not in storage, maybe a frozen default
+        return retrieveFrozenValue(key, keyHash, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+    }
+
+    // Get entry
+    KVATKeyValueEntry tableEntry;
+    bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
+    if (!didReadEntry){return KVATException_tableError;}
+
+    noteEntryAccess(tableEntryN, true);
+
+    // Stub, value is in the tier
+    if (isEntryTiered(&tableEntry)){
+        return retrieveTieredValue(key, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+    }
+
+    KVATSize maxSize = 0;
+
+    // Read value
+    PageDataRef value = fetchData(tableEntry.valuePage, tableEntry.metadata & MVC_ISMULTIPLE, &maxSize, retrieveBuffer, retrieveBufferSize, retrieveBuffer!=NULL);
+    if (value==NULL){return KVATException_fetchFault;}
+
+    // Calculate actual size. A value trimmed to the buffer is measured from its chain (its pages may not all be read).
+    if (size!=NULL){
+        bool isTrimmed = retrieveBuffer!=NULL && retrieveBufferSize<=maxSize;
+        *size = isTrimmed ? getEntryValueSize(&tableEntry) : maxSize-tableEntry.remains;
+        if (*size==0){return KVATException_fetchFault;}
+    }
+
+    // Pass return to inout
+    if (retrievePointerRef!=NULL){
+        *retrievePointerRef = value;
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Retrieves the value of a key already looked up by the caller. Same modes as KVATRetrieveValue: size is what
+ * was fetched, so a value trimmed to the buffer reports the size of the buffer.
+ *
+ * @return KVATException_ ... See retrieveWholeValue
+ */
+static KVATException retrieveValue(const char* key, uint32_t keyHash, PageNumber tableEntryN, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    KVATException exception = retrieveWholeValue(key, keyHash, tableEntryN, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+
+    if (exception==KVATException_none && retrieveBuffer!=NULL && size!=NULL && *size>retrieveBufferSize){
+        *size = retrieveBufferSize;
+    }
+
+    return exception;
+}
+
+/**
+ * Gets the size and flags of a key already looked up by the caller.
+ *
+ * @param      tableEntryN    Entry holding the key, or 0 to fall back to the frozen store.
+ * @param      keyHash        See lookupFrozen.
+ *
+ * @return KVATException_ (notFound) (tableError) (fetchFault) (none)
+ */
+static KVATException statValue(const char* key, uint32_t keyHash, PageNumber tableEntryN, KVATSize* size, KVATFlags* flags){
+    if (tableEntryN==0){
+        const KVATFrozenEntry* frozenEntry = lookupFrozen(key, keyHash);
+        if (frozenEntry==NULL){return KVATException_notFound;}
+
+        if (size!=NULL){
+            *size = frozenEntry->valueSize;
+        }
+        if (flags!=NULL){
+            *flags = KVATFLAG_FROZEN;
+        }
+        return KVATException_none;
+    }
+
+    KVATKeyValueEntry tableEntry;
+    if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+    if (size!=NULL){
+        *size = getEntryValueSize(&tableEntry);
+        if (*size==0){return KVATException_fetchFault;}
+    }
+
+    if (flags!=NULL){
+        *flags = KVATFLAG_NONE;
+        if ((tableEntry.metadata & MVALUEFORMAT)==MVF_COUNTER){
+            *flags |= KVATFLAG_COUNTER;
+        }
+        if (isEntryTiered(&tableEntry)){
+            *flags |= KVATFLAG_TIERED;
+        }
+        if ((tableEntry.metadata & MVALUEFORMAT)==MVF_EVICTABLE){
+            *flags |= KVATFLAG_EVICTABLE;
+        }
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATRetrieveValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    // Assert
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    // Look for this thing
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    return retrieveValue(key, 0, tableEntryN, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+}
+
+KVATException KVATRetrieveValueWithKey(const KVATKey* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size){
+    if (!didInit || !key || !key->string || !retrieveBuffer){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupKey(key->string, key->length);
+
+    return retrieveValue(key->string, key->hash, tableEntryN, retrieveBuffer, retrieveBufferSize, NULL, size);
+}
+
+KVATException KVATStat(const char* key, KVATSize* size, KVATFlags* flags){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    return statValue(key, 0, tableEntryN, size, flags);
+}
+
+KVATException KVATStatWithKey(const KVATKey* key, KVATSize* size, KVATFlags* flags){
+    if (!didInit || !key || !key->string){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupKey(key->string, key->length);
+
+    return statValue(key->string, key->hash, tableEntryN, size, flags);
+}
+
+KVATException KVATRetrieveView(const char* key, const void** view, KVATSize* size){
+    if (!didInit || !key || !view){return KVATException_invalidAccess;}
+
+    *view = NULL;
+
+    // Storage overrides frozen values, and storage is not mapped
+    if (lookupByKey(key, false, 1, NULL, 0)){return KVATException_notMapped;}
+
+    const KVATFrozenEntry* frozenEntry = lookupFrozen(key, 0);
+    if (frozenEntry==NULL){return KVATException_notFound;}
+
+    *view = frozenEntry->value;
+    if (size!=NULL){
+        *size = frozenEntry->valueSize;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATRetrieveStream(const char* key, KVATExportWriter writer, void* context, KVATSize* size){
+    if (!didInit || !key || !writer){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+    if (tableEntryN==0){
+        // Not in storage, maybe a frozen default
+        const KVATFrozenEntry* frozenEntry = lookupFrozen(key, 0);
+        if (frozenEntry==NULL){return KVATException_notFound;}
+
+        if (size!=NULL){
+            *size = frozenEntry->valueSize;
+        }
+        return writer(frozenEntry->value, frozenEntry->valueSize, context) ? KVATException_none : KVATException_storageFault;
+    }
+
+    KVATKeyValueEntry tableEntry;
+    if (!readTableEntry(&tableEntry, tableEntryN)){return KVATException_tableError;}
+
+    // Counter slots are not the value
+    if ((tableEntry.metadata & MVALUEFORMAT)==MVF_COUNTER){return KVATException_invalidAccess;}
+
+    if (size!=NULL){
+        *size = getEntryValueSize(&tableEntry);
+        if (*size==0){return KVATException_fetchFault;}
+    }
+
+    noteEntryAccess(tableEntryN, true);
+
+    // Tier values come whole, in a single call
+    if (isEntryTiered(&tableEntry)){
+        void* value;
+        KVATSize valueSize;
+        KVATException tierException = retrieveTieredValue(key, NULL, 0, &value, &valueSize);
+        if (tierException!=KVATException_none){return tierException;}
+
+        bool didWrite = writer(value, valueSize, context);
+        free(value);
+        return didWrite ? KVATException_none : KVATException_storageFault;
+    }
+
+    return streamData(tableEntry.valuePage, tableEntry.metadata & MVC_ISMULTIPLE, tableEntry.remains, writer, context);
+}
+
+KVATException KVATExists(const char* key){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    return (lookupByKey(key, false, 1, NULL, 0) || lookupFrozen(key, 0)) ? KVATException_none : KVATException_notFound;
+}
+
+KVATException KVATRetrieveValueByBuffer(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size){
+    return KVATRetrieveValue(key, retrieveBuffer, retrieveBufferSize, NULL, size);
+}
+
+KVATException KVATRetrieveStringByBuffer(const char* key, char* retrieveBuffer, KVATSize retrieveBufferSize){
+    return KVATRetrieveValue(key, (void*)retrieveBuffer, retrieveBufferSize, NULL, NULL);
+}
+
+KVATException KVATRetrieveStringByAllocation(const char* key, char** valuePointerRef){
+    return KVATRetrieveValue(key, NULL, 0, (void**) valuePointerRef, NULL);
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC RENAME
+
+/**
+ * Changes the key of a value. See KVATChangeKey. Pins the entry (pinnedEntryN) so writing the new key can't evict it.
+ */
+static KVATException changeKey(const char* currentKey, const char* newKey){
+
+    // Check if new key is available
+    PageNumber tableEntryN = lookupByKey(newKey, false, 1, NULL, 0);
+    if (tableEntryN){return KVATException_keyDuplicate;}
+
+    // Look for this thing
+    tableEntryN = lookupByKey(currentKey, false, 1, NULL, 0);
+    if (tableEntryN==0){return KVATException_notFound;}
+
+    // Get entry
+    KVATKeyValueEntry tableEntry;
+    bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
+    if (!didReadEntry){return KVATException_tableError;}
+
+    // Tier keeps the value under the current key
+    if (isEntryTiered(&tableEntry)){return KVATException_invalidAccess;}
+
+    pinnedEntryN = tableEntryN;
+
+    bool currentKeySavedInMultipleChain = tableEntry.metadata & MKC_ISMULTIPLE;
+    bool newKeySavedInMultipleChain;
+    KVATException writeFailure;
+
+#if CHANGELOG
+    // The old key is kept in a tombstone so the rename is listed as a delete. New key goes into a new chain.
+    PageNumber tombstoneEntryN = getEmptyTableEntryNumber();
+    KVATKeyValueEntry tombstone = {.metadata = currentKeySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE, .keyPage = tableEntry.keyPage};
+
+    PageNumber keyStartPage = writeData((ConstPageDataRef)newKey, strlen(newKey)+1, 0, NULL, &newKeySavedInMultipleChain, NULL, &writeFailure);
+    if (!keyStartPage){return writeFailure;}
+
+    tableEntry.keyPage = keyStartPage;
+    setEntryMetadata(&tableEntry, MKC_ISMULTIPLE, newKeySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE);
+    tableEntry.sequence = ++storeSequence;
+
+    if (!saveTableEntry(&tableEntry, tableEntryN)){
+        followPageChainAndSetPageRecord(keyStartPage, false, newKeySavedInMultipleChain);
+        return KVATException_tableError;
+    }
+
+    tombstone.sequence = ++storeSequence;
+    if (tombstoneEntryN==0 || !saveTableEntry(&tombstone, tombstoneEntryN)){
+        // No room to keep the old key. Its delete can't be listed.
+        followPageChainAndSetPageRecord(tombstone.keyPage, false, currentKeySavedInMultipleChain);
+        raiseSequenceFloor(tombstone.sequence);
+    }
+#else
+    // Save new key using the chain of the old key
+    PageNumber keyStartPage = writeData((ConstPageDataRef)newKey, strlen(newKey)+1, tableEntry.keyPage, tableEntry.metadata & MKC_ISMULTIPLE, &newKeySavedInMultipleChain, NULL, &writeFailure);
+    if (!keyStartPage){
+
+        // No luck with new key, try to put old key back
+        keyStartPage = writeData((ConstPageDataRef)currentKey, strlen(currentKey)+1, tableEntry.keyPage, tableEntry.metadata & MKC_ISMULTIPLE, NULL, NULL, NULL);
+
+        if (!keyStartPage){
+            // Still no luck, this is kind of fatal.
+            // Sorry to do this, but, loss of data is upon us.
+            tableEntry.metadata = MDEFAULT;           // Default this entry
+            saveTableEntry(&tableEntry, tableEntryN); // And save it
+
+            deinit(); // Enter safe mode
+
+            return KVATException_unknown;
+        }
+
+        return writeFailure;
+    }
+
+    // See if metadata needs changing
+    if (newKeySavedInMultipleChain != currentKeySavedInMultipleChain){
+        setEntryMetadata(&tableEntry, MKC_ISMULTIPLE, newKeySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE);
+        saveTableEntry(&tableEntry, tableEntryN);
+    }
+#endif
+
+    noteKeyCountChange(currentKey, false);
+    noteKeyCountChange(newKey, true);
+
+    notifySubscribers(currentKey, KVATEvent_renameFrom, 0);
+    if (subscriptionCount){
+        notifySubscribers(newKey, KVATEvent_renameTo, getEntryValueSize(&tableEntry));
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATChangeKey(const char* currentKey, const char* newKey){
+    if (!didInit || currentKey==NULL || newKey==NULL){return KVATException_invalidAccess;}
+
+    KVATException exception = changeKey(currentKey, newKey);
+    pinnedEntryN = 0;
+
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC DELETE
+
+/**
+ * Deletes the value of a key already looked up by the caller.
+ *
+ * @param      tableEntryN    Entry holding the key, or 0 if not found.
+ *
+ * @return KVATException_ (notFound) (tableError) (none)
+ */
+static KVATException deleteValue(const char* key, PageNumber tableEntryN){
+    if (tableEntryN==0){return KVATException_notFound;}
 
     // Get entry
     KVATKeyValueEntry tableEntry;
     bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
     if (!didReadEntry){return KVATException_tableError;}
 
-    KVATSize maxSize = 0;
+    // Change metadata to mark entry as deleted
+    MetaData formerMetadata = tableEntry.metadata;
+    setEntryDeleted(&tableEntry);
+
+    // Save to end
+    bool didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
+    if (!didSaveEntry){return KVATException_tableError;}
+
+    // Clear pages no longer used from registry
+    releaseDeletedEntryPages(&tableEntry, formerMetadata);
+
+    if ((formerMetadata & MVALUEFORMAT)==MVF_TIERED){
+        removeTieredValue(key);
+    }
+
+    noteKeyCountChange(key, false);
+
+    notifySubscribers(key, KVATEvent_delete, 0);
+
+    return KVATException_none;
+}
+
+KVATException KVATDeleteValue(const char* key){
+    // Assert
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    // Look for this thing
+    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
+
+    return deleteValue(key, tableEntryN);
+}
+
+KVATException KVATDeleteValueWithKey(const KVATKey* key){
+    if (!didInit || !key || !key->string){return KVATException_invalidAccess;}
+
+    PageNumber tableEntryN = lookupKey(key->string, key->length);
+
+    return deleteValue(key->string, tableEntryN);
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC COUNT
+
+KVATException KVATCount(KVATSize* count){
+    if (!didInit || !count){return KVATException_invalidAccess;}
+
+    *count = activeEntryCount;
+
+    return KVATException_none;
+}
+
+KVATException KVATRegisterPrefixCounter(const char* prefix){
+    if (!didInit || !prefix){return KVATException_invalidAccess;}
+
+    // Find a free slot, making sure prefix isn't already registered
+    PrefixCounter* freeCounter = NULL;
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        if (prefixCounters[counterI].prefix==NULL){
+            if (freeCounter==NULL){freeCounter = &prefixCounters[counterI];}
+        }else if (strcmp(prefixCounters[counterI].prefix, prefix)==0){
+            return KVATException_keyDuplicate;
+        }
+    }
+    if (freeCounter==NULL){return KVATException_insufficientSpace;}
+
+    KVATSize prefixLength = strlen(prefix);
+    char* prefixCopy = malloc(prefixLength+1);  // Permanent allocation (until unregistered)
+    if (prefixCopy==NULL){return KVATException_heapError;}
+    memcpy(prefixCopy, prefix, prefixLength+1);
+
+    freeCounter->prefix = prefixCopy;
+    freeCounter->length = prefixLength;
+    freeCounter->count = countKeysWithPrefix(prefix);
+
+    return KVATException_none;
+}
+
+KVATException KVATUnregisterPrefixCounter(const char* prefix){
+    if (!prefix){return KVATException_invalidAccess;}
+
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        if (prefixCounters[counterI].prefix!=NULL && strcmp(prefixCounters[counterI].prefix, prefix)==0){
+            free(prefixCounters[counterI].prefix);
+            prefixCounters[counterI].prefix = NULL;
+            return KVATException_none;
+        }
+    }
+
+    return KVATException_notFound;
+}
+
+KVATException KVATCountPrefix(const char* prefix, KVATSize* count){
+    if (!didInit || !prefix || !count){return KVATException_invalidAccess;}
+
+    for (KVATSize counterI = 0; counterI<PREFIXCOUNTERMAX; counterI++){
+        if (prefixCounters[counterI].prefix!=NULL && strcmp(prefixCounters[counterI].prefix, prefix)==0){
+            *count = prefixCounters[counterI].count;
+            return KVATException_none;
+        }
+    }
+
+    return KVATException_notFound;
+}
+
+KVATException KVATDeletePrefix(const char* prefix, KVATSize* deletedCount){
+    if (!didInit || !prefix){return KVATException_invalidAccess;}
+
+    KVATSize prefixSize = strlen(prefix);
+    KVATSize deleted = 0;
+
+    // Preallocated buffer for key fetches
+    char entryKeyPreallocBuff[STRINGKEYSTDLEN];
+    char* entryKey;
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+    if (entries==NULL){return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+
+    // Single pass over the table, a batch of entries at a time
+    for (KVATSize batchStart = 1; batchStart<index->pageCount && exception==KVATException_none; batchStart += batchCount){
+        PageNumber entriesLeft = index->pageCount-batchStart;
+        PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+        if (!readTableEntries(entries, batchStart, batchSize)){exception = KVATException_tableError; break;}
+
+        // Span of the batch that was cleared
+        PageNumber firstCleared = batchSize;
+        PageNumber lastCleared = 0;
+        MetaData clearedMetadata[EEPROMBLOCKSIZE/sizeof(KVATKeyValueEntry)];    // Metadata before clearing. MDEFAULT if not cleared.
+        uint8_t clearedCounters[EEPROMBLOCKSIZE/sizeof(KVATKeyValueEntry)];     // Prefix counters of the cleared keys, counted once committed
+
+        for (PageNumber batchI = 0; batchI<batchSize; batchI++){
+            KVATKeyValueEntry* entry = &entries[batchI];
+            clearedMetadata[batchI] = MDEFAULT;
+            if (!(entry->metadata & MACTIVE)){continue;}
+
+            entryKey = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, (PageDataRef)entryKeyPreallocBuff, STRINGKEYSTDLEN, false);
+            if (entryKey==NULL){exception = KVATException_fetchFault; break;}
+
+            if (strncmp(entryKey, prefix, prefixSize)==0){
+                clearedMetadata[batchI] = entry->metadata;
+                setEntryDeleted(entry);
+
+                clearedCounters[batchI] = matchPrefixCounters(entryKey);
+
+                if (batchI<firstCleared){firstCleared = batchI;}
+                lastCleared = batchI;
+            }
+
+            if (entryKey != entryKeyPreallocBuff){
+                free(entryKey);
+            }
+        }
+
+        // Single program for the cleared span of the batch
+        if (firstCleared<=lastCleared){
+            if (!saveTableEntries(&entries[firstCleared], batchStart+firstCleared, lastCleared-firstCleared+1)){
+                exception = KVATException_tableError;
+                break;
+            }
+        }
+
+        // Entries are committed. Notify and return their pages to record.
+        for (PageNumber batchI = firstCleared; batchI<=lastCleared && batchI<batchSize; batchI++){
+            if (clearedMetadata[batchI]==MDEFAULT){continue;}
+
+            KVATKeyValueEntry* entry = &entries[batchI];
+            entry->metadata = clearedMetadata[batchI];
+
+            noteMatchedKeyCountChange(clearedCounters[batchI], false);
+            deleted++;
+
+            notifySubscribersOfEntry(entry, KVATEvent_delete, 0);
+
+            if ((clearedMetadata[batchI] & MVALUEFORMAT)==MVF_TIERED){
+                removeTieredValueOfEntry(entry);
+            }
+
+            releaseDeletedEntryPages(entry, clearedMetadata[batchI]);
+        }
+    }
+
+    free(entries);
+
+    if (deletedCount!=NULL){
+        *deletedCount = deleted;
+    }
+
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC CHANGE LOG
+
+KVATException KVATChangesSince(KVATSequence sequence, KVATChangesCallback callback, void* context, KVATSequence* currentSequence){
+#if CHANGELOG
+    if (!didInit || !callback){return KVATException_invalidAccess;}
+
+    if (currentSequence!=NULL){
+        *currentSequence = storeSequence;
+    }
+
+    // Deletes after the given sequence might be gone
+    if (sequence<index->sequenceFloor){return KVATException_historyTruncated;}
+
+    // Preallocated buffer for key fetches
+    char entryKeyPreallocBuff[STRINGKEYSTDLEN];
+    char* entryKey;
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+    if (entries==NULL){return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+    bool shouldContinue = true;
+
+    for (KVATSize batchStart = 1; batchStart<index->pageCount && shouldContinue; batchStart += batchCount){
+        PageNumber entriesLeft = index->pageCount-batchStart;
+        PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+        if (!readTableEntries(entries, batchStart, batchSize)){exception = KVATException_tableError; break;}
+
+        for (PageNumber batchI = 0; batchI<batchSize && shouldContinue; batchI++){
+            KVATKeyValueEntry* entry = &entries[batchI];
+            if (entry->metadata & MOPEN || entry->sequence==0){continue;}
+
+            // Counters don't update their entry on every add. Always list them.
+            bool isActive = entry->metadata & MACTIVE;
+            bool isCounter = isActive && (entry->metadata & MVALUEFORMAT)==MVF_COUNTER;
+            if (entry->sequence<=sequence && !isCounter){continue;}
+
+            entryKey = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, (PageDataRef)entryKeyPreallocBuff, STRINGKEYSTDLEN, false);
+            if (entryKey==NULL){exception = KVATException_fetchFault; shouldContinue = false; break;}
+
+            shouldContinue = callback(entryKey, isActive ? KVATEvent_save : KVATEvent_delete, entry->sequence, context);
+
+            if (entryKey != entryKeyPreallocBuff){
+                free(entryKey);
+            }
+        }
+    }
+
+    free(entries);
+
+    return exception;
+#else
+    return KVATException_invalidAccess;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC SUBSCRIPTIONS
+
+KVATException KVATSubscribe(const char* key, bool isPrefix, KVATChangeCallback callback, void* context, KVATSubscriptionID* subscriptionID){
+    if (!key || !callback){return KVATException_invalidAccess;}
+
+    // Find a free slot
+    KVATSize freeI = 0;
+    while (freeI<SUBSCRIPTIONMAX && subscriptions[freeI].key!=NULL){freeI++;}
+    if (freeI==SUBSCRIPTIONMAX){return KVATException_insufficientSpace;}
+
+    KVATSize keyLength = strlen(key);
+    char* keyCopy = malloc(keyLength+1);    // Permanent allocation (until unsubscribed)
+    if (keyCopy==NULL){return KVATException_heapError;}
+    memcpy(keyCopy, key, keyLength+1);
+
+    Subscription* subscription = &subscriptions[freeI];
+    subscription->key = keyCopy;
+    subscription->length = keyLength;
+    subscription->isPrefix = isPrefix;
+    subscription->callback = callback;
+    subscription->context = context;
+    subscriptionCount++;
+
+    if (subscriptionID!=NULL){
+        *subscriptionID = freeI+1;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATUnsubscribe(KVATSubscriptionID subscriptionID){
+    if (subscriptionID==0 || subscriptionID>SUBSCRIPTIONMAX){return KVATException_invalidAccess;}
+
+    Subscription* subscription = &subscriptions[subscriptionID-1];
+    if (subscription->key==NULL){return KVATException_notFound;}
+
+    free(subscription->key);
+    subscription->key = NULL;
+    subscriptionCount--;
+
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC SEARCH
+
+KVATException KVATSearch(const char* key, KVATSearchID* searchID, char* keyFound, KVATSize keyFoundMaxSize){
+
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    // Look for a partial match of the key, pass the inout buffer
+    PageNumber entryMatchN = lookupByKey(key, true, *searchID, keyFound, keyFoundMaxSize);
+
+    // No match, return exception
+    if (!entryMatchN){
+        return KVATException_notFound;
+    }
+
+    // Did find match, update the id (search placeholder)
+    *searchID = entryMatchN+1;
+    return KVATException_none;
+}
+
+KVATException KVATSearchMany(const char* key, KVATSearchID* searchID, char* resultsBuffer, KVATSize resultsBufferSize, KVATSearchID* resultIDs, KVATSize maxResults, KVATSize* resultCount){
+    if (!didInit || !key || !searchID || !resultsBuffer || maxResults==0){return KVATException_invalidAccess;}
+
+    KVATSize keySize = strlen(key);
+    KVATSize found = 0;
+    KVATSize bufferUsed = 0;
+    bool isFull = false;
+
+    // Preallocated buffer for key fetches
+    char entryKeyPreallocBuff[STRINGKEYSTDLEN];
+    char* entryKey;
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+    if (entries==NULL){return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+    KVATSize entryN = *searchID ? *searchID : 1;
+
+    // Single pass from the search placeholder, a batch of entries at a time
+    while (entryN<index->pageCount && !isFull && exception==KVATException_none){
+        PageNumber entriesLeft = index->pageCount-entryN;
+        PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+        if (!readTableEntries(entries, entryN, batchSize)){exception = KVATException_tableError; break;}
+
+        PageNumber batchI = 0;
+        for ( ; batchI<batchSize; batchI++){
+            KVATKeyValueEntry* entry = &entries[batchI];
+            if (!(entry->metadata & MACTIVE)){continue;}
+
+            entryKey = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, (PageDataRef)entryKeyPreallocBuff, STRINGKEYSTDLEN, false);
+            if (entryKey==NULL){exception = KVATException_fetchFault; break;}
+
+            if (strncmp(entryKey, key, keySize)==0){
+                KVATSize entryKeySize = strlen(entryKey)+1;
+
+                if (bufferUsed+entryKeySize > resultsBufferSize){
+                    // Does not fit. Next call resumes here.
+                    isFull = true;
+                    if (found==0){exception = KVATException_invalidAccess;}  // Buffer can't even hold a single key
+                }else{
+                    memcpy(resultsBuffer+bufferUsed, entryKey, entryKeySize);
+                    bufferUsed += entryKeySize;
+
+                    if (resultIDs!=NULL){
+                        resultIDs[found] = entryN+batchI;
+                    }
+                    found++;
+                    if (found==maxResults){
+                        isFull = true;
+                        batchI++;   // Resume after this one
+                    }
+                }
+            }
+
+            if (entryKey != entryKeyPreallocBuff){
+                free(entryKey);
+            }
+
+            if (isFull){break;}
+        }
+
+        entryN += batchI;
+    }
+
+    free(entries);
+
+    // Update the search placeholder
+    *searchID = entryN;
+
+    if (resultCount!=NULL){
+        *resultCount = found;
+    }
+
+    if (exception==KVATException_none && found==0){
+        exception = KVATException_notFound;
+    }
+
+    return exception;
+}
+
+KVATException KVATQuery(const char* pattern, KVATQueryCallback callback, void* context, KVATSize* matchCount){
+    if (!didInit || !pattern || !callback){return KVATException_invalidAccess;}
+
+    KVATSize patternLength = strlen(pattern);
+    if (patternLength>PATTERNMAXLEN){return KVATException_invalidAccess;}
+
+    KVATSize matched = 0;
+
+    // Preallocated buffer for matched key fetches
+    char entryKeyPreallocBuff[STRINGKEYSTDLEN];
+    char* entryKey;
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+    PageDataRef pageBuffer = malloc(PAGESIZE);
+    if (entries==NULL || pageBuffer==NULL){free(entries); free(pageBuffer); return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+    bool shouldContinue = true;
+
+    // Single pass over the table, a batch of entries at a time
+    for (KVATSize batchStart = 1; batchStart<index->pageCount && shouldContinue; batchStart += batchCount){
+        PageNumber entriesLeft = index->pageCount-batchStart;
+        PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+        if (!readTableEntries(entries, batchStart, batchSize)){exception = KVATException_tableError; break;}
+
+        for (PageNumber batchI = 0; batchI<batchSize && shouldContinue; batchI++){
+            KVATKeyValueEntry* entry = &entries[batchI];
+            if (!(entry->metadata & MACTIVE)){continue;}
+
+            // Literal beginning of the pattern discards most keys on their first page
+            if (!matchKeyChain(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, pattern, patternLength, pageBuffer)){continue;}
+
+            // Only keys that matched are fetched whole
+            entryKey = (char*)fetchData(entry->keyPage, entry->metadata & MKC_ISMULTIPLE, NULL, (PageDataRef)entryKeyPreallocBuff, STRINGKEYSTDLEN, false);
+            if (entryKey==NULL){exception = KVATException_fetchFault; shouldContinue = false; break;}
+
+            matched++;
+            shouldContinue = callback(entryKey, context);
+
+            if (entryKey != entryKeyPreallocBuff){
+                free(entryKey);
+            }
+        }
+    }
+
+    free(entries);
+    free(pageBuffer);
+
+    if (matchCount!=NULL){
+        *matchCount = matched;
+    }
+
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC BACKUP
+
+/* BACKUP CONTAINER (little-endian)
+ *
+ * Header:  'K' 'V' 'A' 'T'  version(1)  reserved(1)  count(2)
+ * Record:  keySize(2)  valueSize(4)  flags(1)  key (null terminated)  value
+ *          flags are KVATFLAG_ bits. A tiered value is exported whole, and imported into the tier if one is set.
+ * Trailer: CRC-32 of everything before it (4)
+ *
+ * Version 1 records had a 2 byte valueSize. They are still imported.
+ */
+
+#define BACKUPVERSION 2
+#define BACKUPHEADERSIZE 8
+#define BACKUPRECORDHEADERSIZE 7
+#define BACKUPV1RECORDHEADERSIZE 5
+#define BACKUPKEYSIZEMAX 0xFFFF
+
+// Container being exported or imported, with running checksum
+typedef struct BackupStream{
+    KVATExportWriter writer;
+    KVATImportReader reader;
+    void* context;
+    uint32_t checksum;      // CRC-32 of bytes so far (not inverted)
+}BackupStream;
+
+/**
+ * Updates a CRC-32 (reflected, polynomial 0xEDB88320) with more data. Start with 0xFFFFFFFF and invert at end.
+ *
+ * @param      checksum      Checksum so far.
+ * @param      data          Data to add.
+ * @param      size          Size of data (in bytes).
+ *
+ * @return Updated checksum.
+ */
+static uint32_t updateChecksum(uint32_t checksum, const void* data, KVATSize size){
+    const unsigned char* bytes = data;
+    for (KVATSize byteI = 0; byteI<size; byteI++){
+        checksum ^= bytes[byteI];
+        for (char bitI = 0; bitI<8; bitI++){
+            checksum = (checksum>>1) ^ (0xEDB88320 & -(checksum & 1));
+        }
+    }
+    return checksum;
+}
+
+static bool exportBytes(BackupStream* stream, const void* data, KVATSize size){
+    stream->checksum = updateChecksum(stream->checksum, data, size);
+    return stream->writer(data, size, stream->context);
+}
+
+// Writer for streamData into a backup stream (context)
+static bool exportChunk(const void* data, KVATSize size, void* context){
+    return exportBytes(context, data, size);
+}
+
+/**
+ * Exports a tiered value. Mapped by the tier's view, it is passed a block at a time; without a view it is read whole.
+ *
+ * @param      key           Key of the tiered value.
+ * @param      size          Size of the value, from its stub.
+ *
+ * @return KVATException_ (storageFault) (fetchFault) (heapError) (none) ... See KVATTier view and retrieve
+ *         fetchFault if the tier holds a value of another size.
+ */
+static KVATException exportTieredValue(BackupStream* stream, const char* key, KVATSize size){
+    if (tier==NULL){return KVATException_notMapped;}
+
+    const void* view = NULL;
+    void* value = NULL;
+    KVATSize viewSize = 0;
+    KVATException exception;
+
+    if (tier->view!=NULL){
+        char* tierKey = makeTierKey(key);
+        if (tierKey==NULL){return KVATException_heapError;}
+        exception = tier->view(tierKey, &view, &viewSize);
+        free(tierKey);
+    }else{
+        exception = retrieveTieredValue(key, NULL, 0, &value, &viewSize);
+        view = value;
+    }
+    if (exception==KVATException_none && viewSize!=size){exception = KVATException_fetchFault;}
+
+    for (KVATSize offset = 0; offset<size && exception==KVATException_none; offset += EEPROMBLOCKSIZE){
+        KVATSize transfer = size-offset<EEPROMBLOCKSIZE ? size-offset : EEPROMBLOCKSIZE;
+        if (!exportBytes(stream, (const unsigned char*)view+offset, transfer)){exception = KVATException_storageFault;}
+    }
+
+    free(value);
+    return exception;
+}
+
+static bool importBytes(BackupStream* stream, void* buffer, KVATSize size){
+    if (!stream->reader(buffer, size, stream->context)){return false;}
+    stream->checksum = updateChecksum(stream->checksum, buffer, size);
+    return true;
+}
+
+KVATException KVATExport(KVATExportWriter writer, void* context, KVATSize* exportedCount){
+    if (!didInit || !writer){return KVATException_invalidAccess;}
+
+    BackupStream stream = {.writer = writer, .context = context, .checksum = 0xFFFFFFFF};
+
+    unsigned char header[BACKUPHEADERSIZE] = {'K', 'V', 'A', 'T', BACKUPVERSION, 0, activeEntryCount & 0xFF, activeEntryCount>>8};
+    if (!exportBytes(&stream, header, BACKUPHEADERSIZE)){return KVATException_storageFault;}
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+    if (entries==NULL){return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+    KVATSize exported = 0;
+
+    for (KVATSize batchStart = 1; batchStart<index->pageCount && exception==KVATException_none; batchStart += batchCount){
+        PageNumber entriesLeft = index->pageCount-batchStart;
+        PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+        if (!readTableEntries(entries, batchStart, batchSize)){exception = KVATException_tableError; break;}
+
+        for (PageNumber batchI = 0; batchI<batchSize && exception==KVATException_none; batchI++){
+            KVATKeyValueEntry* entry = &entries[batchI];
+            if (!(entry->metadata & MACTIVE)){continue;}
+
+            // Key and value are streamed a page at a time
+            bool isKeyMultiple = entry->metadata & MKC_ISMULTIPLE;
+            KVATSize keyRemains = 0;
+            KVATSize keySize = measureKeyChain(entry->keyPage, isKeyMultiple, &keyRemains);
+            if (keySize==0){exception = KVATException_fetchFault; break;}
+            if (keySize>BACKUPKEYSIZEMAX){exception = KVATException_invalidAccess; break;}
+
+            // Tiered values are exported with their value, streamed from the tier
+            KVATSize valueSize = getEntryValueSize(entry);
+            if (valueSize==0){exception = KVATException_fetchFault; break;}
+
+            unsigned char flags = KVATFLAG_NONE;
+            if ((entry->metadata & MVALUEFORMAT)==MVF_COUNTER){
+                flags = KVATFLAG_COUNTER;
+            }else if ((entry->metadata & MVALUEFORMAT)==MVF_EVICTABLE){
+                flags = KVATFLAG_EVICTABLE;
+            }else if (isEntryTiered(entry)){
+                flags = KVATFLAG_TIERED;
+            }
+            unsigned char recordHeader[BACKUPRECORDHEADERSIZE] = {keySize & 0xFF, keySize>>8,
+                                                                  valueSize & 0xFF, (valueSize>>8) & 0xFF, (valueSize>>16) & 0xFF, valueSize>>24, flags};
+
+            if (!exportBytes(&stream, recordHeader, BACKUPRECORDHEADERSIZE)){
+                exception = KVATException_storageFault;
+            }else{
+                exception = streamData(entry->keyPage, isKeyMultiple, keyRemains, &exportChunk, &stream);
+            }
+
+            if (exception==KVATException_none){
+                if (isEntryTiered(entry)){
+                    char keyPreallocBuff[STRINGKEYSTDLEN];
+                    char* key = (char*)fetchData(entry->keyPage, isKeyMultiple, NULL, (PageDataRef)keyPreallocBuff, STRINGKEYSTDLEN, false);
+                    exception = key!=NULL ? exportTieredValue(&stream, key, valueSize) : KVATException_fetchFault;
+                    if (key!=keyPreallocBuff){
+                        free(key);
+                    }
+                }else{
+                    exception = streamData(entry->valuePage, entry->metadata & MVC_ISMULTIPLE, entry->remains, &exportChunk, &stream);
+                }
+            }
+
+            if (exception==KVATException_none){
+                exported++;
+            }
+        }
+    }
+
+    free(entries);
+
+    if (exception==KVATException_none){
+        uint32_t checksum = ~stream.checksum;
+        unsigned char trailer[4] = {checksum & 0xFF, (checksum>>8) & 0xFF, (checksum>>16) & 0xFF, checksum>>24};
+        if (!writer(trailer, 4, context)){exception = KVATException_storageFault;}
+    }
+
+    if (exportedCount!=NULL){
+        *exportedCount = exported;
+    }
+
+    return exception;
+}
+
+/**
+ * Writes a chain with data read from a backup stream. Only a block of data is held in memory.
+ *
+ * @param      stream        Stream to read from.
+ * @param      size          Size of the data to read and write.
+ * @param[out] firstPage     Number of the first page of the chain.
+ * @param[out] isMultiple    Indicates if the chain was written in multiple pages.
+ * @param[out] remains       Space left empty in the last page.
+ *
+ * @return KVATException_ (insufficientSpace) (storageFault) (none)
+ */
+static KVATException importChain(BackupStream* stream, KVATSize size, PageNumber* firstPage, bool* isMultiple, KVATSize* remains){
+    ChainWriter writer;
+    if (!beginChainWrite(&writer, size)){return KVATException_insufficientSpace;}
+
+    // Read a block at a time
+    unsigned char buffer[EEPROMBLOCKSIZE];
+    while (writer.writtenSize<size){
+        KVATSize left = size-writer.writtenSize;
+        KVATSize transfer = left<EEPROMBLOCKSIZE ? left : EEPROMBLOCKSIZE;
+
+        if (!importBytes(stream, buffer, transfer)){
+            abortChainWrite(&writer);
+            return KVATException_storageFault;
+        }
+        if (!appendChainWrite(&writer, buffer, transfer)){
+            abortChainWrite(&writer);
+            return KVATException_insufficientSpace;
+        }
+    }
+
+    *isMultiple = writer.isMultipleChain;
+    *firstPage = endChainWrite(&writer, remains);
+    if (*firstPage==0){
+        abortChainWrite(&writer);
+        return KVATException_storageFault;
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Writes a value read from a backup stream into the tier, a block at a time, then its stub into a chain.
+ *
+ * @param      key              Key of the value.
+ * @param      size             Size of the value to read.
+ * @param[out] stubPage         Number of the first page of the stub chain.
+ * @param[out] isStubMultiple   Indicates if the stub was written in multiple pages.
+ * @param[out] stubRemains      Space left empty in the last page of the stub.
+ *
+ * @return KVATException_ (storageFault) (insufficientSpace) (heapError) (none) ... See KVATTier
+ *         storageFault if reader fails.
+ */
+static KVATException importTieredValue(BackupStream* stream, const char* key, KVATSize size, PageNumber* stubPage, bool* isStubMultiple, KVATSize* stubRemains){
+    KVATException exception = openTieredValueWrite(key, size);
+    if (exception!=KVATException_none){return exception;}
+
+    unsigned char buffer[EEPROMBLOCKSIZE];
+    for (KVATSize offset = 0; offset<size && exception==KVATException_none; offset += EEPROMBLOCKSIZE){
+        KVATSize transfer = size-offset<EEPROMBLOCKSIZE ? size-offset : EEPROMBLOCKSIZE;
+        exception = importBytes(stream, buffer, transfer) ? tier->writeChunk(buffer, transfer) : KVATException_storageFault;
+    }
+    if (exception!=KVATException_none){
+        tier->writeAbort();
+        return exception;
+    }
+
+    exception = tier->writeClose();
+    if (exception!=KVATException_none){return exception;}
+
+    // Stub holds the size, as saved by saveValue
+    KVATException writeFailure;
+    *stubPage = writeData((ConstPageDataRef)&size, sizeof(KVATSize), 0, false, isStubMultiple, stubRemains, &writeFailure);
+    if (*stubPage==0){
+        removeTieredValue(key);
+        return writeFailure;
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Removes from the tier the values of the entries imported so far, before a failed import is undone.
+ *
+ * @param      pending         Imported entries not yet saved in the table.
+ * @param      pendingCount    Number of pending entries.
+ * @param      savedEnd        First entry of the table not saved by the import.
+ */
+static void removeImportedTieredValues(KVATKeyValueEntry* pending, PageNumber pendingCount, PageNumber savedEnd){
+    KVATKeyValueEntry entry;
+    for (PageNumber entryN = 1; entryN<savedEnd; entryN++){
+        if (readTableEntry(&entry, entryN) && (entry.metadata & MACTIVE) && isEntryTiered(&entry)){
+            removeTieredValueOfEntry(&entry);
+        }
+    }
+
+    for (PageNumber pendingI = 0; pendingI<pendingCount; pendingI++){
+        if (isEntryTiered(&pending[pendingI])){
+            removeTieredValueOfEntry(&pending[pendingI]);
+        }
+    }
+}
+
+KVATException KVATImport(KVATImportReader reader, void* context, KVATSize* importedCount){
+    if (!didInit || !reader || activeEntryCount || streamEntryN){return KVATException_invalidAccess;}
+
+    BackupStream stream = {.reader = reader, .context = context, .checksum = 0xFFFFFFFF};
+
+    unsigned char header[BACKUPHEADERSIZE];
+    if (!importBytes(&stream, header, BACKUPHEADERSIZE)){return KVATException_storageFault;}
+    if (memcmp(header, "KVAT", 4)!=0 || header[4]<1 || header[4]>BACKUPVERSION){return KVATException_invalidFormat;}
+    bool isVersion1 = header[4]==1;
+    KVATSize recordHeaderSize = isVersion1 ? BACKUPV1RECORDHEADERSIZE : BACKUPRECORDHEADERSIZE;
+
+    KVATSize count = header[6] | header[7]<<8;
+    if (count>=index->pageCount){return KVATException_insufficientSpace;}
+
+#if CHANGELOG
+    // Tombstones go away with the table. Changes up to now can't be listed anymore.
+    if (!raiseSequenceFloor(storeSequence)){return KVATException_storageFault;}
+#endif
+
+    // Start from an empty table and record, so chains are laid out in order
+    KVATException exception = clearTableEntries(0, index->pageCount);
+    if (exception!=KVATException_none){return exception;}
+    if (!updatePageRecord()){deinit(); return KVATException_recordFault;}
+
+    PageNumber batchCount = getEntryBatchCount();
+    KVATKeyValueEntry* entries = calloc(batchCount, sizeof(KVATKeyValueEntry));
+    if (entries==NULL){return KVATException_heapError;}
+
+    PageNumber batchFill = 0;
+    PageNumber batchStart = 1;
+    KVATSize imported = 0;
+
+    for (; imported<count && exception==KVATException_none; imported++){
+        unsigned char recordHeader[BACKUPRECORDHEADERSIZE];
+        if (!importBytes(&stream, recordHeader, recordHeaderSize)){exception = KVATException_storageFault; break;}
+
+        KVATSize keySize = recordHeader[0] | recordHeader[1]<<8;
+        KVATSize valueSize = recordHeader[2] | recordHeader[3]<<8;
+        if (!isVersion1){
+            valueSize |= recordHeader[4]<<16 | (KVATSize)recordHeader[5]<<24;
+        }
+        unsigned char flags = recordHeader[recordHeaderSize-1];
+        bool isCounter = flags & KVATFLAG_COUNTER;
+        MetaData valueFormat = isCounter ? MVF_COUNTER : (flags & KVATFLAG_EVICTABLE) ? MVF_EVICTABLE : MVF_RAW;
+        if (keySize<2 || valueSize==0 || (isCounter && valueSize!=PAGESIZE)){exception = KVATException_invalidFormat; break;}
+
+        KVATKeyValueEntry* entry = &entries[batchFill];
+        bool isKeyMultiple, isValueMultiple;
+        KVATSize keyRemains, valueRemains;
+
+        exception = importChain(&stream, keySize, &entry->keyPage, &isKeyMultiple, &keyRemains);
+        if (exception!=KVATException_none){break;}
+
+        // Raw values the tier would take on a save (or that were tiered) go to the tier, as saveValue does
+        bool isToTier = tier!=NULL && valueFormat==MVF_RAW && (flags & KVATFLAG_TIERED || (tier->sizeThreshold && valueSize>tier->sizeThreshold));
+        if (isToTier){
+            char keyPreallocBuff[STRINGKEYSTDLEN];
+            char* key = (char*)fetchData(entry->keyPage, isKeyMultiple, NULL, (PageDataRef)keyPreallocBuff, STRINGKEYSTDLEN, false);
+            exception = key!=NULL ? importTieredValue(&stream, key, valueSize, &entry->valuePage, &isValueMultiple, &valueRemains) : KVATException_fetchFault;
+            if (key!=keyPreallocBuff){
+                free(key);
+            }
+            valueFormat = MVF_TIERED;
+        }else{
+            exception = importChain(&stream, valueSize, &entry->valuePage, &isValueMultiple, &valueRemains);
+        }
+        if (exception!=KVATException_none){break;}
+
+        entry->metadata = MACTIVE | (isKeyMultiple ? MKC_MULTIPLE : MKC_SINGLE) | (isValueMultiple ? MVC_MULTIPLE : MVC_SINGLE)
+                        | MKF_STRING | valueFormat;
+        entry->remains = valueRemains;
+#if CHANGELOG
+        entry->sequence = ++storeSequence;
+#endif
+
+        // Table is written a batch at a time
+        if (++batchFill==batchCount){
+            if (!saveTableEntries(entries, batchStart, batchFill)){exception = KVATException_tableError; break;}
+            batchStart += batchFill;
+            batchFill = 0;
+        }
+    }
+
+    if (exception==KVATException_none && batchFill){
+        if (!saveTableEntries(entries, batchStart, batchFill)){exception = KVATException_tableError;}
+    }
+
+    // Trailer is not part of the checksum
+    if (exception==KVATException_none){
+        uint32_t checksum = ~stream.checksum;
+        unsigned char trailer[4];
+        if (!reader(trailer, 4, context)){
+            exception = KVATException_storageFault;
+        }else if ((trailer[0] | trailer[1]<<8 | trailer[2]<<16 | (uint32_t)trailer[3]<<24)!=checksum){
+            exception = KVATException_invalidFormat;
+        }
+    }
+
+    // Nothing is kept from a failed import
+    if (exception!=KVATException_none){
+        removeImportedTieredValues(entries, batchFill, batchStart);
+#if CHANGELOG
+        raiseSequenceFloor(storeSequence);
+#endif
+        clearTableEntries(0, index->pageCount);
+        imported = 0;
+    }
+
+    free(entries);
+
+    // Keys were never added one by one. Rebuild runtime state from the table.
+    if (!updatePageRecord()){deinit(); return KVATException_recordFault;}
+    recountPrefixCounters();
+
+    if (importedCount!=NULL){
+        *importedCount = imported;
+    }
+
+    return exception;
+}
+
+#if MIGRATION
+//////////////////////////////////////////////////////////////////
+//  MIGRATION
+
+/* MIGRATION
+ *
+ * A store in a known layout (by format ID) with a different layout or geometry than the current one is
+ * migrated by KVATInit instead of formatted:
+ *  1. Live entries are staged (key, value and value format) past both the old and the new store.
+ *     Nothing of the old store is touched, so a reset here starts over.
+ *  2. The staging header is programmed at the end of storage, magic last. The migration is now committed.
+ *  3. The new store is formatted, and the staged entries saved into it. A reset here resumes on next init.
+ *  4. The magic of the staging header is cleared.
+ * Work goes by live data: only active entries are read and saved (plus clearing the new table).
+ * If storage has no room past the store, entries are staged in RAM, and a reset during steps 3 and 4
+ * loses them as a format would.
+ *
+ * Staged entry: keySize(2) valueSize(2)  valueFormat(1) pad(3)  key  value  (key and value padded to words)
+ * Counters are staged as their count. Tiered values as their stub.
+ * Staging header (last STAGINGHEADERSIZE bytes of storage): dataStart  dataSize  checksum  sequence  magic
+ *
+ */
+
+#define STAGINGHEADERSIZE 20
+#define STAGINGMAGIC 0x474D564B     // 'KVMG'
+
+// Stored layout of a format ID. When the layout changes, give it a new FORMATID and keep the old one here.
+typedef struct StoredFormat{
+    uint16_t formatID;
+    KVATSize indexSize;     // Size of the stored index (table follows it)
+    KVATSize entrySize;     // Size of a stored table entry. metadata, keyPage, valuePage and remains lead in all.
+    bool hasSequence;       // Entries carry a sequence after the leading fields, and the index a sequence floor last
+}StoredFormat;
+
+static const StoredFormat knownFormats[] = {
+    {214, 16, 4, false},
+    {215, 20, 8, true}
+};
+
+// Staged entries, in storage or in RAM
+typedef struct Staging{
+    StorageAddress address;     // Start of the staged entries in storage
+    uint32_t* ram;              // Staged entries in RAM instead, if not NULL
+    KVATSize capacity;
+    KVATSize size;              // Bytes staged so far
+    uint32_t checksum;          // CRC-32 of bytes staged so far (not inverted)
+    uint32_t sequence;          // Greatest sequence of the old store
+}Staging;
+
+static const StoredFormat* getStoredFormat(uint16_t formatID){
+    for (KVATSize formatI = 0; formatI<sizeof(knownFormats)/sizeof(StoredFormat); formatI++){
+        if (knownFormats[formatI].formatID==formatID){
+            return &knownFormats[formatI];
+        }
+    }
+    return NULL;
+}
+
+static StorageAddress getNaturalStoreEnd(){
+    return getNaturalAddressOfPage0() + PAGESIZE*PAGECOUNT;
+}
+
+static bool stageWords(Staging* staging, const uint32_t* words, KVATSize size){
+    if (staging->size+size > staging->capacity){return false;}
+
+    if (staging->ram!=NULL){
+        memcpy((char*)staging->ram+staging->size, words, size);
+    }else if (!programStorage(words, staging->address+staging->size, size)){
+        return false;
+    }
+
+    staging->checksum = updateChecksum(staging->checksum, words, size);
+    staging->size += size;
+    return true;
+}
+
+static bool unstageWords(Staging* staging, KVATSize offset, uint32_t* words, KVATSize size){
+    if (offset+size > staging->size){return false;}
+
+    if (staging->ram!=NULL){
+        memcpy(words, (char*)staging->ram+offset, size);
+        return true;
+    }
+    return readStorage(words, staging->address+offset, size);
+}
+
+/**
+ * Stages an entry: a header word pair, then key and value padded to words.
+ */
+static bool stageEntry(Staging* staging, const char* key, const void* value, KVATSize valueSize, MetaData valueFormat){
+    KVATSize keySize = strlen(key)+1;
+    KVATSize keyPadded = (keySize+3) & ~3;
+    KVATSize valuePadded = (valueSize+3) & ~3;
+
+    uint32_t* words = calloc(1, 8+keyPadded+valuePadded);
+    if (words==NULL){return false;}
+
+    words[0] = keySize | valueSize<<16;
+    words[1] = valueFormat;
+    memcpy(words+2, key, keySize);
+    memcpy((char*)(words+2)+keyPadded, value, valueSize);
+
+    bool didStage = stageWords(staging, words, 8+keyPadded+valuePadded);
+    free(words);
+
+    return didStage;
+}
+
+/**
+ * Reads a chain of the stored layout, with its geometry (page size and begin address) from the index as read.
+ * The engine's page functions can't: they take PAGESIZE as a constant.
+ *
+ * @param[out] maxSize       Size of the data in the chain (max, before remains). A null terminator follows it.
+ *
+ * @return Allocated data, or NULL on fault.
+ */
+static char* fetchStoredChain(PageNumber startPage, bool isChainMultiple, KVATSize* maxSize){
+    KVATSize pageNextSize = getPageNextSize(isChainMultiple);
+    KVATSize pageDataSize = index->pageSize-pageNextSize;
+
+    uint32_t* page = malloc(index->pageSize);
+    char* data = NULL;
+    KVATSize dataSize = 0;
+    PageNumber pageN = startPage;
+
+    for (PageNumber i = 0; page!=NULL && pageN!=0; i++){
+        char* grownData = i<index->pageCount ? realloc(data, dataSize+pageDataSize+1) : NULL;
+        if (grownData==NULL || !readStorage(page, index->pageBeginAddress+pageN*index->pageSize, index->pageSize)){
+            free(grownData!=NULL ? grownData : data);
+            data = NULL;
+            break;
+        }
+        data = grownData;
+
+        memcpy(data+dataSize, (char*)page+pageNextSize, pageDataSize);
+        dataSize += pageDataSize;
+        data[dataSize] = '\0';
+
+        pageN = isChainMultiple ? *(PageNumber*)page : 0;
+    }
+
+    free(page);
+
+    *maxSize = dataSize;
+    return data;
+}
+
+/**
+ * Reads the count of a counter of the stored layout (greatest of its slots, see readCounterSlots).
+ *
+ * @return Success of the read.
+ */
+static bool readStoredCounter(PageNumber page, KVATCounter* count){
+    KVATSize maxSize;
+    KVATCounter* slots = (KVATCounter*)fetchStoredChain(page, false, &maxSize);
+    if (slots==NULL){return false;}
+
+    *count = slots[0];
+    for (KVATSize slotI = 1; slotI<maxSize/sizeof(KVATCounter); slotI++){
+        if (slots[slotI]>*count){
+            *count = slots[slotI];
+        }
+    }
+
+    free(slots);
+    return true;
+}
+
+/**
+ * Stages every active entry of the old store. The index holds the old geometry, and its chains are read
+ * with fetchStoredChain.
+ *
+ * @return KVATException_ (tableError) (fetchFault) (insufficientSpace) (heapError) (none)
+ */
+static KVATException stageLiveEntries(const StoredFormat* format, Staging* staging){
+    uint32_t* storedEntry = malloc(format->entrySize);
+    if (storedEntry==NULL){return KVATException_heapError;}
+
+    KVATException exception = KVATException_none;
+
+    for (PageNumber entryN = 1; entryN<index->pageCount && exception==KVATException_none; entryN++){
+        if (!readStorage(storedEntry, INDEXSTART+format->indexSize+entryN*format->entrySize, format->entrySize)){
+            exception = KVATException_tableError;
+            break;
+        }
+
+        KVATKeyValueEntry entry;
+        memcpy(&entry, storedEntry, 4);
+        if (format->hasSequence && storedEntry[1]>staging->sequence){
+            staging->sequence = storedEntry[1];
+        }
+        if (!(entry.metadata & MACTIVE)){continue;}
+
+        KVATSize maxSize = 0;
+        char* key = fetchStoredChain(entry.keyPage, entry.metadata & MKC_ISMULTIPLE, &maxSize);
+        if (key==NULL){exception = KVATException_fetchFault; break;}
+
+        MetaData valueFormat = entry.metadata & MVALUEFORMAT;
+        void* value = NULL;
+        KVATSize valueSize = 0;
+
+        if (valueFormat==MVF_COUNTER){
+            // Slots depend on the page size. Only the count goes.
+            value = malloc(sizeof(KVATCounter));
+            if (value!=NULL && !readStoredCounter(entry.valuePage, (KVATCounter*)value)){
+                free(value);
+                value = NULL;
+            }
+            valueSize = sizeof(KVATCounter);
+        }else{
+            value = fetchStoredChain(entry.valuePage, entry.metadata & MVC_ISMULTIPLE, &maxSize);
+            valueSize = maxSize-entry.remains;
+        }
+
+        if (value==NULL){
+            exception = KVATException_fetchFault;
+        }else if (!stageEntry(staging, key, value, valueSize, valueFormat)){
+            exception = KVATException_insufficientSpace;
+        }
+
+        free(key);
+        free(value);
+    }
+
+    free(storedEntry);
+
+    return exception;
+}
+
+/**
+ * Checks the staged entries against their checksum, before the old store is gone.
+ *
+ * @return true if they match.
+ */
+static bool checkStagedEntries(Staging* staging, uint32_t checksum){
+    uint32_t word;
+    uint32_t stagedChecksum = 0xFFFFFFFF;
+    for (KVATSize offset = 0; offset<staging->size; offset += 4){
+        if (!unstageWords(staging, offset, &word, 4)){return false;}
+        stagedChecksum = updateChecksum(stagedChecksum, &word, 4);
+    }
+    return ~stagedChecksum==checksum;
+}
+
+/**
+ * Formats the store in the current layout and saves the staged entries into it.
+ * Entries that don't fit the new geometry are left out.
+ *
+ * @return KVATException_ (tableError) (storageFault) (heapError) (recordFault) (none)
+ */
+static KVATException restoreStagedEntries(Staging* staging){
+    KVATException exception = formatMemory();
+    if (exception!=KVATException_none){return exception;}
+#if CHANGELOG
+    // Sequences go on from the old store. Its changes can't be listed anymore.
+    index->sequenceFloor = staging->sequence;
+    exception = saveIndex();
+    if (exception!=KVATException_none){return exception;}
+#endif
+    if (!updatePageRecord()){return KVATException_recordFault;}
+
+    for (KVATSize offset = 0; offset<staging->size && exception==KVATException_none; ){
+        uint32_t header[2];
+        if (!unstageWords(staging, offset, header, 8)){exception = KVATException_storageFault; break;}
+
+        KVATSize keySize = header[0] & 0xFFFF;
+        KVATSize valueSize = header[0]>>16;
+        KVATSize keyPadded = (keySize+3) & ~3;
+        KVATSize valuePadded = (valueSize+3) & ~3;
+        MetaData valueFormat = header[1] & MVALUEFORMAT;
+
+        uint32_t* data = malloc(keyPadded+valuePadded);
+        if (data==NULL){exception = KVATException_heapError; break;}
+
+        if (!unstageWords(staging, offset+8, data, keyPadded+valuePadded)){
+            exception = KVATException_storageFault;
+        }else{
+            const char* key = (const char*)data;
+            const void* value = (char*)data+keyPadded;
+
+            if (valueFormat==MVF_COUNTER){
+                PageDataRef slots = calloc(1, PAGESIZE);
+                if (slots==NULL){
+                    exception = KVATException_heapError;
+                }else{
+                    memcpy(slots, value, sizeof(KVATCounter));
+                    exception = saveValueInEntry(key, 0, slots, PAGESIZE, MVF_COUNTER, NULL);
+                    free(slots);
+                }
+            }else{
+                exception = saveValueInEntry(key, 0, value, valueSize, valueFormat, NULL);
+            }
+
+            // Left out if the new geometry is smaller
+            if (exception==KVATException_insufficientSpace){
+                exception = KVATException_none;
+            }
+        }
+
+        free(data);
+        offset += 8+keyPadded+valuePadded;
+    }
+
+    return exception;
+}
+
+/**
+ * Migrates the store if it is in a known layout other than the current one, or resumes a migration that was
+ * interrupted after it was committed. The index and storageSize must have been read.
+ *
+ * @return KVATException_ (storageFault) (heapError) (invalidFormat) ... See stageLiveEntries and restoreStagedEntries
+ *         invalidFormat if the staged entries didn't read back as staged (the old store is kept).
+ */
+static KVATException migrateMemory(){
+    StorageAddress headerAddress = storageSize - STAGINGHEADERSIZE;
+    bool canStageInStorage = storageSize >= getNaturalStoreEnd()+STAGINGHEADERSIZE;
+    uint32_t header[STAGINGHEADERSIZE/4];
+
+    Staging staging = {.checksum = 0xFFFFFFFF};
 
-    // Read value
-    PageDataRef value = fetchData(tableEntry.valuePage, tableEntry.metadata & MVC_ISMULTIPLE, &maxSize, retrieveBuffer, retrieveBufferSize, retrieveBuffer!=NULL);
-    if (value==NULL){return KVATException_fetchFault;}
+    // Committed migration that didn't finish
+    if (canStageInStorage){
+        if (!readStorage(header, headerAddress, STAGINGHEADERSIZE)){return KVATException_storageFault;}
 
-    // Calculate actual size
-    if (size!=NULL){
-        *size = maxSize-tableEntry.remains;
+        if (header[4]==STAGINGMAGIC){
+            staging.address = header[0];
+            staging.size = header[1];
+            staging.capacity = header[1];
+            staging.sequence = header[3];
+
+            // A header that doesn't hold up is not a migration
+            bool isStagingValid = staging.address>=getNaturalStoreEnd() && staging.address<=headerAddress
+                                  && staging.size<=headerAddress-staging.address && checkStagedEntries(&staging, header[2]);
+
+            KVATException exception = isStagingValid ? restoreStagedEntries(&staging) : KVATException_none;
+            if (exception!=KVATException_none){return exception;}
+
+            uint32_t clearedMagic = 0;
+            if (!programStorage(&clearedMagic, headerAddress+16, 4)){return KVATException_storageFault;}
+
+            if (isStagingValid){return KVATException_none;}
+
+            staging = (Staging){.checksum = 0xFFFFFFFF};
+        }
     }
 
-    // Pass return to inout
-    if (retrievePointerRef!=NULL){
-        *retrievePointerRef = value;
+    // Nothing to migrate: current layout, or not a store at all. Page count is the store's own (KVATResize).
+    const StoredFormat* format = getStoredFormat(index->formatID);
+    if (format==NULL){return KVATException_none;}
+    if (index->formatID==FORMATID && index->pageSize==PAGESIZE){
+        return KVATException_none;
     }
 
-    return KVATException_none;
-}
+    // Old geometry must make sense before chains are followed
+    StorageAddress oldStoreEnd = index->pageBeginAddress + index->pageSize*index->pageCount;
+    if (index->pageSize<4 || index->pageSize%4 || index->pageCount<2 || oldStoreEnd>storageSize
+            || index->pageBeginAddress>oldStoreEnd || INDEXSTART+format->indexSize+format->entrySize*index->pageCount>oldStoreEnd){
+        return KVATException_none;
+    }
 
-KVATException KVATRetrieveValueByBuffer(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size){
-    return KVATRetrieveValue(key, retrieveBuffer, retrieveBufferSize, NULL, size);
+    if (format->hasSequence){
+        if (!readStorage(&staging.sequence, INDEXSTART+format->indexSize-4, 4)){return KVATException_storageFault;}
+    }
+
+    // Past both stores if the entries fit
+    KVATException exception = KVATException_insufficientSpace;
+    staging.address = oldStoreEnd>getNaturalStoreEnd() ? oldStoreEnd : getNaturalStoreEnd();
+    staging.address = (staging.address+3) & ~3;
+
+    if (canStageInStorage && staging.address<headerAddress){
+        staging.capacity = headerAddress-staging.address;
+        exception = stageLiveEntries(format, &staging);
+    }
+
+    // Or in RAM. Room for every page full, plus entry headers and padding.
+    if (exception==KVATException_insufficientSpace){
+        staging.capacity = index->pageCount*(index->pageSize+14);
+        staging.ram = malloc(staging.capacity);
+        if (staging.ram==NULL){return KVATException_heapError;}
+
+        staging.size = 0;
+        staging.checksum = 0xFFFFFFFF;
+        exception = stageLiveEntries(format, &staging);
+    }
+
+    if (exception==KVATException_none && staging.ram==NULL){
+        // Commit: fields first, magic last
+        header[0] = staging.address;
+        header[1] = staging.size;
+        header[2] = ~staging.checksum;
+        header[3] = staging.sequence;
+        header[4] = STAGINGMAGIC;
+        if (!programStorage(header, headerAddress, 16) || !programStorage(&header[4], headerAddress+16, 4)){
+            exception = KVATException_storageFault;
+        }
+    }
+
+    if (exception==KVATException_none){
+        exception = checkStagedEntries(&staging, ~staging.checksum) ? restoreStagedEntries(&staging) : KVATException_invalidFormat;
+    }
+
+    if (exception==KVATException_none && staging.ram==NULL){
+        uint32_t clearedMagic = 0;
+        if (!programStorage(&clearedMagic, headerAddress+16, 4)){exception = KVATException_storageFault;}
+    }
+
+    free(staging.ram);
+
+    return exception;
 }
+#endif
 
-KVATException KVATRetrieveStringByBuffer(const char* key, char* retrieveBuffer, KVATSize retrieveBufferSize){
-    return KVATRetrieveValue(key, (void*)retrieveBuffer, retrieveBufferSize, NULL, NULL);
+//////////////////////////////////////////////////////////////////
+//  PUBLIC TIERING
+
+KVATException KVATSetTier(const KVATTier* newTier){
+    if (newTier!=NULL && (!newTier->writeOpen || !newTier->writeChunk || !newTier->writeClose || !newTier->writeAbort || !newTier->retrieve || !newTier->remove)){
+        return KVATException_invalidAccess;
+    }
+
+    // Cold values are found by last access. Every entry starts as just used.
+    if (newTier!=NULL && newTier->coldOperations && entryLastAccess==NULL){
+        entryLastAccess = malloc(sizeof(uint32_t)*PAGECOUNTMAX); // Permanent allocation. Room for any table size (KVATResize).
+        if (entryLastAccess==NULL){return KVATException_heapError;}
+
+        for (KVATSize entryI = 0; entryI<PAGECOUNTMAX; entryI++){
+            entryLastAccess[entryI] = tierOperation;
+        }
+    }
+
+    tier = newTier;
+
+    return KVATException_none;
 }
 
-KVATException KVATRetrieveStringByAllocation(const char* key, char** valuePointerRef){
-    return KVATRetrieveValue(key, NULL, 0, (void**) valuePointerRef, NULL);
+KVATException KVATTierService(KVATSize* movedCount){
+    if (!didInit || tier==NULL || streamEntryN){return KVATException_invalidAccess;}
+
+    KVATSize moved = 0;
+    KVATException exception = KVATException_none;
+
+    if (tier->coldOperations && entryLastAccess!=NULL){
+        PageNumber batchCount = getEntryBatchCount();
+        KVATKeyValueEntry* entries = malloc(sizeof(KVATKeyValueEntry)*batchCount);
+        if (entries==NULL){return KVATException_heapError;}
+
+        for (KVATSize batchStart = 1; batchStart<index->pageCount && exception==KVATException_none; batchStart += batchCount){
+            PageNumber entriesLeft = index->pageCount-batchStart;
+            PageNumber batchSize = entriesLeft<batchCount ? entriesLeft : batchCount;
+
+            if (!readTableEntries(entries, batchStart, batchSize)){exception = KVATException_tableError; break;}
+
+            for (PageNumber batchI = 0; batchI<batchSize && exception==KVATException_none; batchI++){
+                KVATKeyValueEntry* entry = &entries[batchI];
+                PageNumber tableEntryN = batchStart+batchI;
+
+                // Only settled raw values that went unused long enough
+                if ((entry->metadata & (MACTIVE | MOPEN))!=MACTIVE || (entry->metadata & MVALUEFORMAT)!=MVF_RAW){continue;}
+                if (tierOperation-entryLastAccess[tableEntryN] < tier->coldOperations){continue;}
+
+                exception = moveEntryToTier(entry, tableEntryN);
+                if (exception==KVATException_none){
+                    moved++;
+                }
+            }
+        }
+
+        free(entries);
+    }
+
+    if (movedCount!=NULL){
+        *movedCount = moved;
+    }
+
+    return exception;
 }
 
 //////////////////////////////////////////////////////////////////
-//  PUBLIC RENAME
+//  RESIZE
 
-KVATException KVATChangeKey(const char* currentKey, const char* newKey){
+// Pages keep their address. A larger table takes the first pages, a smaller store drops the last ones.
+// Chains on those pages are copied to kept pages, then entries past a smaller table are moved down.
+// The index is written last: until then, the store reads as it was.
 
-    if (!didInit || currentKey==NULL || newKey==NULL){return KVATException_invalidAccess;}
+static bool writeChainChunk(const void* data, KVATSize size, void* context){
+    return appendChainWrite(context, data, size);
+}
 
-    // Check if new key is available
-    PageNumber tableEntryN = lookupByKey(newKey, false, 1, NULL, 0);
-    if (tableEntryN){return KVATException_keyDuplicate;}
+/**
+ * Counts the pages of a chain that are out of the pages kept by a resize.
+ *
+ * @param[out] keptCount      Optional: Incremented by the number of pages of the chain that are kept.
+ *
+ * @return Number of pages out of the kept ones. The chain needs to be copied if not 0.
+ */
+static KVATSize countChainPagesOut(PageNumber startPage, bool isChainMultiple, KVATSize firstKeptPage, KVATSize keptPageEnd, KVATSize* keptCount){
+    KVATSize outCount = 0;
+    PageNumber pageN = startPage;
+
+    for (PageNumber i = 0; pageN!=0 && i<index->pageCount; i++){
+        if (pageN<firstKeptPage || pageN>=keptPageEnd){
+            outCount++;
+        }else if (keptCount!=NULL){
+            (*keptCount)++;
+        }
+        if (!isChainMultiple){
+            pageN = 0;
+        }else if (!readNextPageNumber(pageN, &pageN)){
+            return outCount+1;      // Unreadable: counted out, so its copy is attempted (and fails)
+        }
+    }
+    return outCount;
+}
 
-    // Look for this thing
-    tableEntryN = lookupByKey(currentKey, false, 1, NULL, 0);
-    if (tableEntryN==0){return KVATException_notFound;}
+/**
+ * Sets the pages out of the kept ones to used, so chains aren't given any of them. Undone by updatePageRecord.
+ */
+static void reserveResizedPages(KVATSize firstKeptPage, KVATSize keptPageEnd){
+    for (KVATSize pageN = 1; pageN<index->pageCount; pageN++){
+        if (pageN<firstKeptPage || pageN>=keptPageEnd){
+            markPageInRecord(pageN, true);
+        }
+    }
+}
 
-    // Get entry
-    KVATKeyValueEntry tableEntry;
-    bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
-    if (!didReadEntry){return KVATException_tableError;}
+/**
+ * Copies a chain into new pages. Same size, so the copy has the same layout (multiple or single, remains).
+ * Only takes empty pages: nothing is reclaimed or evicted for it.
+ *
+ * @return Number of the first page of the copy. 0 if there are not enough empty pages, or on storage failure.
+ */
+static PageNumber copyChain(PageNumber startPage, bool isChainMultiple, KVATSize remains){
+    PageNumber chainPageCount = getChainPageCount(startPage, isChainMultiple);
+    if (chainPageCount==0){return 0;}
 
-    bool currentKeySavedInMultipleChain = tableEntry.metadata & MKC_ISMULTIPLE;
-    bool newKeySavedInMultipleChain;
+    KVATSize pagesEmpty = 0;
+    for (KVATSize pageN = 1; pageN<index->pageCount; pageN++){
+        if (!checkPageFromRecord(pageN)){pagesEmpty++;}
+    }
+    if (pagesEmpty<chainPageCount){return 0;}
 
-    // Save new key using the chain of the old key
-    PageNumber keyStartPage = writeData((ConstPageDataRef)newKey, strlen(newKey)+1, tableEntry.keyPage, tableEntry.metadata & MKC_ISMULTIPLE, &newKeySavedInMultipleChain, NULL);
-    if (!keyStartPage){
+    KVATSize pageDataSize = PAGESIZE-getPageNextSize(isChainMultiple);
+    KVATSize size = pageDataSize*chainPageCount-remains;
 
-        // No luck with new key, try to put old key back
-        keyStartPage = writeData((ConstPageDataRef)currentKey, strlen(currentKey)+1, tableEntry.keyPage, tableEntry.metadata & MKC_ISMULTIPLE, NULL, NULL);
+    ChainWriter writer;
+    if (!beginChainWrite(&writer, size)){return 0;}
 
-        if (!keyStartPage){
-            // Still no luck, this is kind of fatal.
-            // Sorry to do this, but, loss of data is upon us.
-            tableEntry.metadata = MDEFAULT;           // Default this entry
-            saveTableEntry(&tableEntry, tableEntryN); // And save it
+    PageNumber copyStartPage = 0;
+    if (streamData(startPage, isChainMultiple, remains, &writeChainChunk, &writer)==KVATException_none){
+        copyStartPage = endChainWrite(&writer, NULL);
+    }
 
-            deinit(); // Enter safe mode
+    if (copyStartPage==0){
+        abortChainWrite(&writer);
+    }
+    return copyStartPage;
+}
 
-            return KVATException_unknown;
-        }
+/**
+ * Copies the chains of an entry (key and value, or key of a tombstone) that are out of the kept pages,
+ * and points the entry to the copies.
+ *
+ * @param      entry          Entry to relocate. Updated on success.
+ * @param      tableEntryN    Position of the entry.
+ *
+ * @return KVATException_ (insufficientSpace) (tableError) (none)
+ */
+static KVATException relocateEntryChains(KVATKeyValueEntry* entry, PageNumber tableEntryN, KVATSize firstKeptPage, KVATSize keptPageEnd){
+    bool isKeyMultiple = entry->metadata & MKC_ISMULTIPLE;
+    bool isValueMultiple = entry->metadata & MVC_ISMULTIPLE;
+    bool hasValue = entry->metadata & MACTIVE;
 
-        return KVATException_insufficientSpace;
+    bool shouldCopyKey = countChainPagesOut(entry->keyPage, isKeyMultiple, firstKeptPage, keptPageEnd, NULL);
+    bool shouldCopyValue = hasValue && countChainPagesOut(entry->valuePage, isValueMultiple, firstKeptPage, keptPageEnd, NULL);
+    if (!shouldCopyKey && !shouldCopyValue){return KVATException_none;}
+
+    KVATKeyValueEntry relocated = *entry;
+    bool didCopy = true;
+
+    if (shouldCopyKey){
+        relocated.keyPage = copyChain(entry->keyPage, isKeyMultiple, 0);
+        didCopy = relocated.keyPage!=0;
+    }
+    if (shouldCopyValue && didCopy){
+        relocated.valuePage = copyChain(entry->valuePage, isValueMultiple, entry->remains);
+        didCopy = relocated.valuePage!=0;
     }
 
-    // See if metadata needs changing
-    if (newKeySavedInMultipleChain != currentKeySavedInMultipleChain){
-        setEntryMetadata(&tableEntry, MKC_ISMULTIPLE, newKeySavedInMultipleChain ? MKC_MULTIPLE : MKC_SINGLE);
-        saveTableEntry(&tableEntry, tableEntryN);
+    // Copies are only referenced once the entry is saved
+    KVATException exception = KVATException_none;
+    if (!didCopy){
+        exception = KVATException_insufficientSpace;
+    }else if (!saveTableEntry(&relocated, tableEntryN)){
+        exception = KVATException_tableError;
     }
 
+    if (exception!=KVATException_none){
+        if (shouldCopyKey){followPageChainAndSetPageRecord(relocated.keyPage, false, isKeyMultiple);}
+        if (shouldCopyValue){followPageChainAndSetPageRecord(relocated.valuePage, false, isValueMultiple);}
+        return exception;
+    }
+
+    if (shouldCopyKey){followPageChainAndSetPageRecord(entry->keyPage, false, isKeyMultiple);}
+    if (shouldCopyValue){followPageChainAndSetPageRecord(entry->valuePage, false, isValueMultiple);}
+    *entry = relocated;
+
     return KVATException_none;
 }
 
-//////////////////////////////////////////////////////////////////
-//  PUBLIC DELETE
+/**
+ * Checks if an entry holds chains: active, or a tombstone (keeps its key).
+ */
+static bool isEntryHoldingChains(KVATKeyValueEntry* entry){
+    if (entry->metadata & MACTIVE){return true;}
+#if CHANGELOG
+    return !(entry->metadata & MOPEN) && entry->sequence;
+#else
+    return false;
+#endif
+}
 
-KVATException KVATDeleteValue(const char* key){
-    // Assert
-    if (!didInit || !key){return KVATException_invalidAccess;}
+/**
+ * Checks if the chains of an entry would go on a save short of room: a tombstone, or an evictable value.
+ */
+static bool isEntryReclaimable(KVATKeyValueEntry* entry){
+    if ((entry->metadata & (MACTIVE | MOPEN | MVALUEFORMAT))==(MACTIVE | MVF_EVICTABLE)){return true;}
+#if CHANGELOG
+    return !(entry->metadata & MACTIVE) && isEntryHoldingChains(entry);
+#else
+    return false;
+#endif
+}
 
-    // Look for this thing
-    PageNumber tableEntryN = lookupByKey(key, false, 1, NULL, 0);
-    if (tableEntryN==0){return KVATException_notFound;}
+/**
+ * Goes through the entries of a smaller table for the key pages in use.
+ * An entry past the table with its key page in use was left behind by an interrupted move: its copy is in.
+ *
+ * @param      entryCount     Number of entries in the smaller table.
+ * @param[out] keyPages       Bit per page, set if a key starts on it. (PAGECOUNTMAX+1)/8 bytes.
+ *
+ * @return Success of the table read.
+ */
+static bool readKeyPagesInTable(KVATSize entryCount, unsigned char* keyPages){
+    memset(keyPages, 0, (PAGECOUNTMAX+1)/8);
+    KVATKeyValueEntry entry;
 
-    // Get entry
-    KVATKeyValueEntry tableEntry;
-    bool didReadEntry = readTableEntry(&tableEntry, tableEntryN);
-    if (!didReadEntry){return KVATException_tableError;}
+    for (KVATSize entryN = 1; entryN<entryCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){return false;}
 
-    // Clear pages used in key and value from registry
-    followPageChainAndSetPageRecord(tableEntry.keyPage, false, tableEntry.metadata & MKC_ISMULTIPLE);
-    followPageChainAndSetPageRecord(tableEntry.valuePage, false, tableEntry.metadata & MVC_ISMULTIPLE);
+        if (isEntryHoldingChains(&entry)){
+            keyPages[entry.keyPage/8] |= 1<<(entry.keyPage%8);
+        }
+    }
+    return true;
+}
 
-    // Change metadata to mark entry as empty
-    tableEntry.metadata = MDEFAULT;
+/**
+ * Moves the entries past a smaller table into empty entries within it. Their chains must be in kept pages.
+ * An entry left behind by an interrupted move is only cleared.
+ *
+ * @param      entryCount     Number of entries in the smaller table.
+ *
+ * @return KVATException_ (insufficientSpace) (tableError) (none)
+ */
+static KVATException moveEntriesIntoTable(KVATSize entryCount){
+    unsigned char keyPagesInTable[(PAGECOUNTMAX+1)/8];
+    if (!readKeyPagesInTable(entryCount, keyPagesInTable)){return KVATException_tableError;}
 
-    // Save to end
-    bool didSaveEntry = saveTableEntry(&tableEntry, tableEntryN);
-    if (!didSaveEntry){return KVATException_tableError;}
+    KVATKeyValueEntry entry;
+    PageNumber emptyEntryN = 1;
+    KVATKeyValueEntry emptyEntry = {.metadata = MDEFAULT};
+
+    for (KVATSize entryN = entryCount; entryN<index->pageCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){return KVATException_tableError;}
+        if (!isEntryHoldingChains(&entry)){continue;}
+
+        if (!(keyPagesInTable[entry.keyPage/8] & 1<<(entry.keyPage%8))){
+            KVATKeyValueEntry slot;
+            for (; emptyEntryN<entryCount; emptyEntryN++){
+                if (!readTableEntry(&slot, emptyEntryN)){return KVATException_tableError;}
+                if (!isEntryHoldingChains(&slot) && !(slot.metadata & MOPEN)){break;}
+            }
+            if (emptyEntryN==entryCount){return KVATException_insufficientSpace;}
+
+            if (!saveTableEntry(&entry, emptyEntryN)){return KVATException_tableError;}
+            if (entryLastAccess!=NULL){
+                entryLastAccess[emptyEntryN] = entryLastAccess[entryN];
+            }
+            emptyEntryN++;
+        }
+
+        if (!saveTableEntry(&emptyEntry, entryN)){return KVATException_tableError;}
+    }
 
     return KVATException_none;
 }
 
-KVATException KVATSearch(const char* key, KVATSearchID* searchID, char* keyFound, KVATSize keyFoundMaxSize){
+/**
+ * Checks that the chains out of the kept pages fit in the empty kept pages, and (on a smaller table) that
+ * the entries past it fit in its empty entries. Goes by the chains of the table.
+ *
+ * @param      isReclaimedRoom    Count tombstones and evictable values as gone (the room a save would make).
+ *
+ * @return KVATException_ (insufficientSpace) (tableError) (none)
+ */
+static KVATException checkResizeFits(KVATSize newPageCount, KVATSize firstKeptPage, KVATSize keptPageEnd, bool isReclaimedRoom){
+    unsigned char keyPagesInTable[(PAGECOUNTMAX+1)/8];
+    if (!readKeyPagesInTable(newPageCount<index->pageCount ? newPageCount : index->pageCount, keyPagesInTable)){
+        return KVATException_tableError;
+    }
 
-    if (!didInit || !key){return KVATException_invalidAccess;}
+    KVATSize pagesNeeded = 0;       // Chains kept as they are, or copied whole
+    KVATSize copyOverlap = 0;       // Most kept pages a chain holds while it is copied
+    KVATSize entriesEmpty = 0;
+    KVATSize entriesToMove = 0;
+    KVATKeyValueEntry entry;
 
-    // Look for a partial match of the key, pass the inout buffer
-    PageNumber entryMatchN = lookupByKey(key, true, *searchID, keyFound, keyFoundMaxSize);
+    for (KVATSize entryN = 1; entryN<index->pageCount; entryN++){
+        if (!readTableEntry(&entry, entryN)){return KVATException_tableError;}
 
-    // No match, return exception
-    if (!entryMatchN){
-        return KVATException_notFound;
+        bool isInTable = entryN<newPageCount;
+        if (!isEntryHoldingChains(&entry) || (isReclaimedRoom && isEntryReclaimable(&entry))){
+            if (isInTable && !(entry.metadata & MOPEN)){entriesEmpty++;}
+            continue;
+        }
+
+        if (!isInTable){
+            if (keyPagesInTable[entry.keyPage/8] & 1<<(entry.keyPage%8)){continue;}   // Copy is in
+            entriesToMove++;
+        }
+
+        for (KVATSize chainI = 0; chainI<((entry.metadata & MACTIVE) ? 2 : 1); chainI++){
+            KVATSize keptCount = 0;
+            KVATSize outCount = chainI==0 ? countChainPagesOut(entry.keyPage, entry.metadata & MKC_ISMULTIPLE, firstKeptPage, keptPageEnd, &keptCount)
+                                          : countChainPagesOut(entry.valuePage, entry.metadata & MVC_ISMULTIPLE, firstKeptPage, keptPageEnd, &keptCount);
+
+            pagesNeeded += outCount+keptCount;
+            if (outCount && keptCount>copyOverlap){copyOverlap = keptCount;}
+        }
     }
 
-    // Did find match, update the id (search placeholder)
-    *searchID = entryMatchN+1;
+    if (pagesNeeded+copyOverlap > keptPageEnd-firstKeptPage){return KVATException_insufficientSpace;}
+    if (entriesToMove>entriesEmpty){return KVATException_insufficientSpace;}
+
     return KVATException_none;
 }
 
+/**
+ * Resizes the store in a single step: chains are only copied into pages it already has. Checked by KVATResize.
+ *
+ * @return KVATException_ (insufficientSpace) (tableError) (storageFault) (recordFault) (none)
+ */
+static KVATException resizeStore(KVATSize newPageCount){
+    KVATSize pageCount = index->pageCount;
+    if (newPageCount==pageCount){return KVATException_none;}
+
+    // A larger table takes the first pages, a smaller store drops the last ones
+    KVATSize firstKeptPage = getFirstUsablePage(newPageCount>pageCount ? newPageCount : pageCount);
+    KVATSize keptPageEnd = newPageCount<pageCount ? newPageCount : pageCount;
+    if (firstKeptPage>=keptPageEnd){return KVATException_insufficientSpace;}
+
+    // Short of room, as on a save: tombstones are reclaimed, then evictable values evicted. Only if that's enough.
+    KVATException exception = checkResizeFits(newPageCount, firstKeptPage, keptPageEnd, true);
+    if (exception!=KVATException_none){return exception;}
+
+    exception = checkResizeFits(newPageCount, firstKeptPage, keptPageEnd, false);
+#if CHANGELOG
+    while (exception==KVATException_insufficientSpace && (reclaimOldestTombstone() || evictColdestEntry())){
+#else
+    while (exception==KVATException_insufficientSpace && evictColdestEntry()){
+#endif
+        exception = checkResizeFits(newPageCount, firstKeptPage, keptPageEnd, false);
+    }
+    if (exception!=KVATException_none){return exception;}
+
+    reserveResizedPages(firstKeptPage, keptPageEnd);
+
+    // Chains out of the kept pages are copied into them
+    KVATKeyValueEntry entry;
+    for (KVATSize entryN = 1; entryN<pageCount && exception==KVATException_none; entryN++){
+        if (!readTableEntry(&entry, entryN)){exception = KVATException_tableError; break;}
+        if (!isEntryHoldingChains(&entry)){continue;}
+
+        exception = relocateEntryChains(&entry, entryN, firstKeptPage, keptPageEnd);
+        reserveResizedPages(firstKeptPage, keptPageEnd);   // Old chains were released into the record
+    }
+
+    // Then the table changes size, on its side of the pages
+    if (exception==KVATException_none){
+        exception = newPageCount<pageCount ? moveEntriesIntoTable(newPageCount) : clearTableEntries(pageCount, newPageCount);
+    }
+
+    if (exception==KVATException_none){
+        index->pageCount = newPageCount;
+        exception = saveIndex();
+        if (exception!=KVATException_none){
+            index->pageCount = pageCount;
+        }
+    }
+
+    // Record and clock follow the table size. Reservations are dropped.
+    if (!updatePageRecord()){
+        deinit();
+        return KVATException_recordFault;
+    }
+
+    return exception;
+}
+
+/**
+ * Finds the largest step towards a larger store that resizeStore can take with the pages the store has.
+ * Counts tombstones and evictable values as gone, as resizeStore does.
+ *
+ * @param      newPageCount      Page count the store grows to.
+ * @param[out] stepPageCount     Page count of the step.
+ *
+ * @return KVATException_ (insufficientSpace) (tableError) (none)
+ *         insufficientSpace if not even one more page fits.
+ */
+static KVATException findGrowStep(KVATSize newPageCount, KVATSize* stepPageCount){
+    KVATSize pageCount = index->pageCount;
+    KVATSize fitting = pageCount;           // Largest page count known to fit
+    KVATSize failing = newPageCount+1;      // Smallest page count known not to fit
+
+    // A larger table leaves fewer pages: the first count that doesn't fit is searched in halves
+    while (failing-fitting>1){
+        KVATSize middle = fitting+(failing-fitting)/2;
+        KVATSize firstKeptPage = getFirstUsablePage(middle);
+
+        KVATException exception = KVATException_insufficientSpace;
+        if (firstKeptPage<pageCount){
+            exception = checkResizeFits(middle, firstKeptPage, pageCount, true);
+        }
+
+        if (exception==KVATException_none){
+            fitting = middle;
+        }else if (exception==KVATException_insufficientSpace){
+            failing = middle;
+        }else{
+            return exception;
+        }
+    }
+
+    *stepPageCount = fitting;
+    return fitting>pageCount ? KVATException_none : KVATException_insufficientSpace;
+}
+
 //////////////////////////////////////////////////////////////////
+//  PUBLIC RESIZE
+
+KVATException KVATResize(KVATSize newPageCount){
+    if (!didInit || streamEntryN){return KVATException_invalidAccess;}
+    if (newPageCount<2 || newPageCount>PAGECOUNTMAX){return KVATException_invalidAccess;}
+
+    if (newPageCount<=index->pageCount){return resizeStore(newPageCount);}
+
+    // A larger store must fit in storage. The end of storage is kept for the header of a migration.
+    StorageAddress newStoreEnd = index->pageBeginAddress + PAGESIZE*newPageCount;
+#if MIGRATION
+    newStoreEnd += STAGINGHEADERSIZE;
+#endif
+    if (newStoreEnd>storageSize){return KVATException_insufficientSpace;}
+
+    // Every chain must fit past the larger table, in the pages it keeps and the ones it adds
+    KVATSize firstKeptPage = getFirstUsablePage(newPageCount);
+    if (firstKeptPage>=newPageCount){return KVATException_insufficientSpace;}
+    KVATException exception = checkResizeFits(newPageCount, firstKeptPage, newPageCount, true);
+
+    // Pages past the store only take chains once the index counts them. So it grows in steps, each one
+    // copying chains into the pages the last one added. Entries never point past the store.
+    while (exception==KVATException_none && index->pageCount<newPageCount){
+        KVATSize stepPageCount;
+        exception = findGrowStep(newPageCount, &stepPageCount);
+        if (exception==KVATException_none){
+            exception = resizeStore(stepPageCount);
+        }
+    }
 
-KVATException KVATInit(){
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC STORAGE
+
+KVATException KVATSetBackend(const KVATBackend* newBackend){
     if (didInit){return KVATException_invalidAccess;}
 
-    // Enable the EEPROM module.
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    if (newBackend==NULL){
+        backend = (KVATBackend){.init = NULL};
+        return KVATException_none;
+    }
 
-    // Wait for the EEPROM module to be ready.
-    while(!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0));
+    if (newBackend->init==NULL || newBackend->read==NULL || newBackend->program==NULL){return KVATException_invalidAccess;}
+
+    backend = *newBackend;
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+
+KVATException KVATInit(){
+    if (didInit){return KVATException_invalidAccess;}
 
-    uint32_t memInitStatus = MAP_EEPROMInit();
-    if (memInitStatus==EEPROM_INIT_ERROR){
+    if (backend.init==NULL){
+        backend = (KVATBackend){.init = &eepromInit, .read = &eepromRead, .program = &eepromProgram, .context = NULL};
+    }
 
+    if (!backend.init(backend.context, &storageSize)){
         return KVATException_storageFault;
     }
 
+    // Whole paging region needs to fit
+    if (storageSize < getNaturalAddressOfPage0()+PAGESIZE*PAGECOUNT){
+        return KVATException_insufficientSpace;
+    }
+
     //Get space for the index
     if (index==NULL){
         index = malloc(sizeof(KVATIndex)); // Permanent allocation
         if (index==NULL){return KVATException_heapError;}
     }
 
-    // Read current index from system
-    readIndex();
+    // Read current index from system. A failed read must not be taken for an unformatted memory.
+    KVATException readException = readIndex();
+    if (readException!=KVATException_none){return readException;}
 
-    //Check format ID
-    if (index->formatID!=FORMATID){// Need to format memory
+#if MIGRATION
+    // Older layouts are migrated in place (and interrupted migrations resumed)
+    KVATException migrateException = migrateMemory();
+    if (migrateException!=KVATException_none){return migrateException;}
+#endif
+
+    //Check format ID. Page operations take PAGESIZE as a constant, so the page size must match as well.
+    if (index->formatID!=FORMATID || index->pageSize!=PAGESIZE){// Need to format memory
         KVATException formatException = formatMemory();
         if (formatException!=KVATException_none){   // There was an exception while formatting. Bubble it up.
             return formatException;
@@ -1193,10 +4995,27 @@ KVATException KVATInit(){
     bool wasRecordUpdated = updatePageRecord();
     if (!wasRecordUpdated){return KVATException_recordFault;}
 
+    // Registered prefixes survive a deinit. Recount them.
+    recountPrefixCounters();
+
     didInit = true;
     return KVATException_none;
 }
 
+KVATException KVATDeinit(){
+    if (!didInit){return KVATException_invalidAccess;}
+
+    // An open stream is dropped as a reset would drop it: nothing is programmed. KVATInit frees its entry.
+    if (streamEntryN){
+        free(streamWriter.pageData);
+        streamWriter.pageData = NULL;
+        releaseStream();
+    }
+
+    deinit();
+    return KVATException_none;
+}
+
 /**
  * Internal release for major fault. Call upon the occurrence of an unrecoverable error to prevent further damage.
  */
@@ -26,27 +26,118 @@ typedef enum KVATException{
     KVATException_heapError,            // Related to memory allocation from heap
     KVATException_recordFault,          // Related to empty page record (vector)
     KVATException_tableError,           // write/read to entry table failed. Possible origin: logic/hardware. Safety deinit possible.
-    KVATException_keyDuplicate          // Key already being used
+    KVATException_keyDuplicate,         // Key already being used
+    KVATException_compareMismatch,      // Stored value differs from the expected one
+    KVATException_historyTruncated,     // Changes requested are older than the change log keeps
+    KVATException_invalidFormat,        // Data is not in the expected format, or failed its checksum
+    KVATException_notMapped             // Value is not in memory-mapped storage (can't be viewed in place), or is tiered and no tier is set
 }KVATException;
 
+// Events -------------------------
+
+typedef enum KVATEvent{
+    KVATEvent_save,                     // Value saved (new or overwrite)
+    KVATEvent_delete,                   // Value deleted
+    KVATEvent_renameFrom,               // Key changed away from this one (value now under another key)
+    KVATEvent_renameTo,                 // Key changed into this one
+    KVATEvent_evict                     // Evictable value deleted to make room (see KVATSaveEvictable)
+}KVATEvent;
+
 // Defines --------------------------
 
 #define INITIALID 1
 
+// Value flags (KVATFlags)
+#define KVATFLAG_NONE       0x00
+#define KVATFLAG_COUNTER    0x01    // Value is a counter (see KVATCounterOpen)
+#define KVATFLAG_FROZEN     0x02    // Value comes from the frozen store (see KVATSetFrozenStore)
+#define KVATFLAG_TIERED     0x04    // Value is kept in the tier (see KVATSetTier)
+#define KVATFLAG_EVICTABLE  0x08    // Value can be evicted when storage runs out (see KVATSaveEvictable)
+
 // Types --------------------------
 
 typedef uint32_t KVATSize;
 typedef uint32_t KVATSearchID;
+typedef uint32_t KVATCounter;
+typedef uint32_t KVATFlags;
+
+typedef uint32_t KVATSubscriptionID;
+typedef uint32_t KVATSequence;
+typedef struct KVATFrozenStore KVATFrozenStore;    // See kvat_frozen.h
+
+// Called for every key matched by KVATQuery. Return false to stop the query.
+typedef bool (*KVATQueryCallback)(const char* key, void* context);
+
+// Called after a change to a subscribed key is committed. size is the size of the value after the change (0 if none).
+typedef void (*KVATChangeCallback)(const char* key, KVATEvent event, KVATSize size, void* context);
+
+// Receives the next bytes of a backup from KVATExport (or of a value from KVATRetrieveStream). Return false on failure.
+typedef bool (*KVATExportWriter)(const void* data, KVATSize size, void* context);
+
+// Provides exactly size bytes of a backup to KVATImport. Return false on failure (or end of data).
+typedef bool (*KVATImportReader)(void* buffer, KVATSize size, void* context);
+
+// Called for every change listed by KVATChangesSince (event is save or delete). Return false to stop listing.
+typedef bool (*KVATChangesCallback)(const char* key, KVATEvent event, KVATSequence sequence, void* context);
+
+// Storage the store runs on (see KVATSetBackend). Addresses and sizes passed are multiples of 4 bytes.
+// Every function returns false on failure. context is passed as is.
+typedef struct KVATBackend{
+    bool (*init)(void* context, uint32_t* size);    // Prepares the memory and reports its size in bytes
+    bool (*read)(void* context, uint32_t address, void* data, uint32_t size);
+    bool (*program)(void* context, uint32_t address, const void* data, uint32_t size);
+    void* context;
+}KVATBackend;
+
+// Secondary store for large or cold values (see KVATSetTier). The functions match the log store's (kvatlog.h).
+typedef struct KVATTier{
+    KVATException (*writeOpen)(const char* key, KVATSize expectedSize);
+    KVATException (*writeChunk)(const void* chunk, KVATSize chunkSize);
+    KVATException (*writeClose)();
+    KVATException (*writeAbort)();
+    KVATException (*retrieve)(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size);
+    KVATException (*remove)(const char* key);
+    KVATSize sizeThreshold;     // Values saved larger than this go to the tier. 0 to save every value in storage.
+    uint32_t coldOperations;    // Values not read or saved within this many reads and saves are moved by KVATTierService. 0 for never.
+    KVATException (*view)(const char* key, const void** view, KVATSize* size);  // Optional: maps a value in place (KVATExport streams from it). NULL to read values whole.
+}KVATTier;
+
+// Cached reference to a counter. Skips key lookup on counter operations.
+// Valid until the key is deleted or overwritten with a regular value, or the store is resized (KVATResize).
+typedef struct KVATCounterHandle{
+    uint32_t entry;     // Internal: table entry of the counter
+    uint32_t page;      // Internal: page holding the counter slots
+}KVATCounterHandle;
+
+// Key with its length known, for the ...WithKey calls. Those match keys without measuring them or allocating.
+// Keys known at build time come with their hash too: generated for C (tools/kvatkeys), constexpr in C++ (kvat.hpp).
+typedef struct KVATKey{
+    const char* string;     // Null terminated at length
+    KVATSize length;        // Length of string (without terminator)
+    uint32_t hash;          // Optional: kvatFrozenHash(string, 0), where hashed lookups (frozen store, log store) start. 0 to compute it when needed.
+}KVATKey;
 
 // Prototypes ----------------------
 
 /**
- * Initializes kvat for operation. Formats EEPROM if necessary (Format ID mismatch).
+ * Initializes kvat for operation. Formats EEPROM (or the storage set with KVATSetBackend) if necessary (Format ID or page size mismatch).
+ * A store in a known older layout, or with another page size, is migrated instead: its entries are kept.
+ * The page count is the store's own (set on format to PAGECOUNT, changed by KVATResize).
+ * Migration stages entries in storage past the store (in RAM if there is no room), and resumes if interrupted by a reset.
  *
- * @return KVATException_ (invalidAccess) (storageFault) (heapError) (recordFault) (none) ...
+ * @return KVATException_ (invalidAccess) (storageFault) (insufficientSpace) (heapError) (recordFault) (none) ...
+ *         insufficientSpace if the storage is too small for the table and pages.
  */
 KVATException KVATInit();
 
+/**
+ * Stops kvat without programming anything, as a reset would. An open stream is dropped (KVATInit frees its entry).
+ * KVATInit starts it again.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATDeinit();
+
 
 /**
  * Saves data tagged with a key
@@ -55,11 +146,69 @@ KVATException KVATInit();
  * @param      value          Reference to value to save in storage
  * @param      valueSize      Length of the value to save
  *
- * @return KVATException_ (invalidAccess) (insufficientSpace) (tableError) (none)
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (tableError) (fetchFault) (storageFault) (none)
  */
 KVATException KVATSaveValue(const char* key, const void* value, KVATSize valueSize);
 
 
+/**
+ * Saves data tagged with a key of known length. Same as KVATSaveValue.
+ *
+ * @param      key            Key for the value to save
+ * @param      value          Reference to value to save in storage
+ * @param      valueSize      Length of the value to save
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (tableError) (fetchFault) (storageFault) (none)
+ */
+KVATException KVATSaveValueWithKey(const KVATKey* key, const void* value, KVATSize valueSize);
+
+
+/**
+ * Saves data tagged with a key as evictable, for a persistent cache. When a save runs out of entries or pages
+ * (and, with CHANGELOG, there are no tombstones left to reclaim), the coldest evictable values are deleted to
+ * make room, instead of failing with insufficientSpace. Coldness is approximate (CLOCK): values read since
+ * the last pass of the clock are spared once; saving doesn't count. Subscribers get KVATEvent_evict from within the save
+ * that needed room, and must not call into the store from it. Evictions are listed as deletes by KVATChangesSince.
+ * Saving the key with KVATSaveValue makes it permanent again. Evictable values are never tiered.
+ *
+ * @param      key            String tag for the value to save
+ * @param      value          Reference to value to save in storage
+ * @param      valueSize      Length of the value to save
+ *
+ * @return KVATException_ ... See KVATSaveValue
+ *         insufficientSpace if evicting every evictable value doesn't make enough room (values evicted stay evicted).
+ */
+KVATException KVATSaveEvictable(const char* key, const void* value, KVATSize valueSize);
+
+
+/**
+ * Saves data tagged with a key only if it differs from what is stored.
+ * Comparison is done page by page during a single lookup. Nothing is programmed when equal.
+ *
+ * @param      key            String tag for the value to save
+ * @param      value          Reference to value to save in storage
+ * @param      valueSize      Length of the value to save
+ * @param[out] didSave        Optional: Set to true if the value was written.
+ *
+ * @return KVATException_ ... See KVATSaveValue
+ */
+KVATException KVATSaveIfChanged(const char* key, const void* value, KVATSize valueSize, bool* didSave);
+
+
+/**
+ * Saves data tagged with a key only if the stored value matches an expected one. Single lookup.
+ *
+ * @param      key            String tag for the value to save
+ * @param      expectedValue  Reference to the value expected in storage. Pass NULL to expect the key not to exist.
+ * @param      expectedSize   Length of the expected value
+ * @param      value          Reference to value to save in storage
+ * @param      valueSize      Length of the value to save
+ *
+ * @return KVATException_ (compareMismatch) (notFound) ... See KVATSaveValue
+ */
+KVATException KVATCompareAndSave(const char* key, const void* expectedValue, KVATSize expectedSize, const void* value, KVATSize valueSize);
+
+
 /**
  * Saves a string of data tagged with a key. KVATSaveValue convenience.
  *
@@ -71,6 +220,110 @@ KVATException KVATSaveValue(const char* key, const void* value, KVATSize valueSi
 KVATException KVATSaveString(const char* key, const char* value);
 
 
+/**
+ * Opens a streaming write of a value tagged with a key. Only one stream can be open at a time.
+ * Pages are programmed as data arrives, so only a single page is kept in memory regardless of value size.
+ * The entry is committed on KVATWriteClose. Until then, the previous value (if any) stays readable.
+ * Other calls on the same key while the stream is open are not supported.
+ *
+ * @param      key            String tag for the value to save
+ * @param      expectedSize   Total size of the value that will be written through KVATWriteChunk
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (tableError) (storageFault) (none)
+ */
+KVATException KVATWriteOpen(const char* key, KVATSize expectedSize);
+
+
+/**
+ * Appends a chunk of data to the open stream.
+ * On failure other than invalidAccess, the stream is discarded.
+ *
+ * @param      chunk          Reference to data to append
+ * @param      chunkSize      Size of the chunk. Total of all chunks must not exceed the expected size.
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (none)
+ */
+KVATException KVATWriteChunk(const void* chunk, KVATSize chunkSize);
+
+
+/**
+ * Completes the open stream and commits the entry. Stream is closed in all cases.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (storageFault) (tableError) (none)
+ *         invalidAccess if the data written does not add up to the expected size (stream is discarded).
+ */
+KVATException KVATWriteClose();
+
+
+/**
+ * Discards the open stream. The previous value (if any) is kept.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATWriteAbort();
+
+
+/**
+ * Gets a handle for a counter, creating it (with a count of 0) if the key does not exist.
+ * Counters rotate through the word slots of a single page so every increment is one word program on a different word.
+ *
+ * @param      key            String tag for the counter
+ * @param[out] handle         Reference to handle to set up.
+ *
+ * @return KVATException_ (invalidAccess) (heapError) ... See KVATSaveValue
+ *         invalidAccess if the key holds a value that is not a counter.
+ */
+KVATException KVATCounterOpen(const char* key, KVATCounterHandle* handle);
+
+
+/**
+ * Adds to a counter through a handle. No lookup: a single table entry read, page read and word program.
+ * Counters saturate at their maximum.
+ *
+ * @param      handle         Reference to a handle from KVATCounterOpen
+ * @param      delta          Amount to add
+ * @param[out] newCount       Optional: Count after adding.
+ *
+ * @return KVATException_ (invalidAccess) (fetchFault) (storageFault) (none)
+ */
+KVATException KVATCounterAddByHandle(const KVATCounterHandle* handle, KVATCounter delta, KVATCounter* newCount);
+
+
+/**
+ * Reads a counter through a handle. No lookup.
+ *
+ * @param      handle         Reference to a handle from KVATCounterOpen
+ * @param[out] count          Current count.
+ *
+ * @return KVATException_ (invalidAccess) (fetchFault) (none)
+ */
+KVATException KVATCounterGetByHandle(const KVATCounterHandle* handle, KVATCounter* count);
+
+
+/**
+ * Adds to a counter tagged with a key, creating it if it does not exist. KVATCounterOpen + KVATCounterAddByHandle convenience.
+ *
+ * @param      key            String tag for the counter
+ * @param      delta          Amount to add
+ * @param[out] newCount       Optional: Count after adding.
+ *
+ * @return KVATException_ ... See KVATCounterOpen and KVATCounterAddByHandle
+ */
+KVATException KVATCounterAdd(const char* key, KVATCounter delta, KVATCounter* newCount);
+
+
+/**
+ * Reads a counter tagged with a key.
+ *
+ * @param      key            String tag for the counter
+ * @param[out] count          Current count.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (none)
+ *         invalidAccess if the key holds a value that is not a counter.
+ */
+KVATException KVATCounterGet(const char* key, KVATCounter* count);
+
+
 /**
  * Reads value from storage corresponding to specified key.
  * Supports passing reference to a buffer to read data into, as well as allowing for memory to be specifically allocated for.
@@ -82,13 +335,94 @@ KVATException KVATSaveString(const char* key, const char* value);
  * @param[out] valuePointRef        Optional: Reference to a pointer that will be set to point to retrieved data. Useful on allocate mode.
  *                                  Gets set to NULL if no match found.
  *                                  To use allocate mode, pass NULL on retrieveBuffer and retrieveBufferSize, and a valid argument on valuePointRef.
- * @param[out] size                 Optional: Size of the value fetched in bytes.
+ * @param[out] size                 Optional: Size of the value fetched in bytes. A value trimmed to the buffer reports
+ *                                  retrieveBufferSize (KVATStat gives its full size).
  *
- * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (none)
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (notMapped) (none)
+ *         Tiered values come from the tier (see KVATSetTier); notMapped if no tier is set.
  */
 KVATException KVATRetrieveValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size);
 
 
+/**
+ * Reads a value into a buffer, with a key of known length. Never allocates: values longer than the buffer are trimmed.
+ *
+ * @param      key                  Key for the value to retrieve
+ * @param[out] retrieveBuffer       Reference to buffer to retrieve value into.
+ * @param      retrieveBufferSize   Size of retrieve buffer.
+ * @param[out] size                 Optional: Size of the value fetched in bytes, as KVATRetrieveValue.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (notMapped) (none)
+ */
+KVATException KVATRetrieveValueWithKey(const KVATKey* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size);
+
+
+/**
+ * Gets information on the value corresponding to a key without reading the value itself.
+ * Single page values are answered from the table entry alone. Otherwise only the chain links are read.
+ * Useful to size a buffer before a retrieve.
+ *
+ * @param      key            String tag for the value
+ * @param[out] size           Optional: Size of the value in bytes.
+ * @param[out] flags          Optional: KVATFLAG_ bits describing the value.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (none)
+ */
+KVATException KVATStat(const char* key, KVATSize* size, KVATFlags* flags);
+
+
+/**
+ * Gets information on the value corresponding to a key of known length. Same as KVATStat.
+ *
+ * @param      key            Key for the value
+ * @param[out] size           Optional: Size of the value in bytes.
+ * @param[out] flags          Optional: KVATFLAG_ bits describing the value.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (none)
+ */
+KVATException KVATStatWithKey(const KVATKey* key, KVATSize* size, KVATFlags* flags);
+
+
+/**
+ * Reads a value a page at a time into a writer, through a fixed page buffer. The value is never held whole in memory.
+ * Falls back to the frozen store like KVATRetrieveValue (passed in a single call).
+ *
+ * @param      key            String tag for the value to retrieve
+ * @param      writer         Function that receives the value, a piece at a time, in order.
+ * @param      context        Optional: Passed to writer as is.
+ * @param[out] size           Optional: Size of the value in bytes (set before the first piece).
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (fetchFault) (storageFault) (none)
+ *         invalidAccess on counters. storageFault if writer fails.
+ */
+KVATException KVATRetrieveStream(const char* key, KVATExportWriter writer, void* context, KVATSize* size);
+
+
+/**
+ * Gets a read-only pointer to a value where it is stored, with no copy and no allocation.
+ * Only values in memory-mapped storage can be viewed: currently, values from the frozen store (see KVATSetFrozenStore).
+ * The pointer stays valid while the store is set.
+ *
+ * @param      key            String tag for the value
+ * @param[out] view           Set to point to the value. NULL if it can't be viewed.
+ * @param[out] size           Optional: Size of the value in bytes.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (notMapped) (none)
+ *         notMapped if the value is in EEPROM. Use KVATRetrieveValue.
+ */
+KVATException KVATRetrieveView(const char* key, const void** view, KVATSize* size);
+
+
+/**
+ * Checks if a key exists. No value data is read.
+ *
+ * @param      key            String tag to look for
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATExists(const char* key);
+
+
 /**
  * Reads value from storage corresponding to specified key. KVATRetrieveValue convenience.
  * Supports passing reference to a buffer to read data into.
@@ -134,7 +468,7 @@ KVATException KVATRetrieveStringByAllocation(const char* key, char** valuePointe
  * @param      currentKey      Current key.
  * @param      newKey          New key to change into.
  *
- * @return KVATException_ (invalidAccess) (keyDuplicate) (notFound) (tableError) (unknown) (insufficientSpace) (none)
+ * @return KVATException_ (invalidAccess) (keyDuplicate) (notFound) (tableError) (unknown) (insufficientSpace) (fetchFault) (storageFault) (none)
  */
 KVATException KVATChangeKey(const char* currentKey, const char* newKey);
 
@@ -148,6 +482,71 @@ KVATException KVATChangeKey(const char* currentKey, const char* newKey);
  */
 KVATException KVATDeleteValue(const char* key);
 
+
+/**
+ * Deletes a saved value, with a key of known length. Same as KVATDeleteValue.
+ *
+ * @param      key            Key for the value to delete
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (tableError) (none)
+ */
+KVATException KVATDeleteValueWithKey(const KVATKey* key);
+
+
+/**
+ * Deletes all the values whose keys begin with a prefix. Single pass over the table.
+ * Entry clears are programmed together per block of table entries.
+ *
+ * @param      prefix         Beginning of the keys to delete. Pass "" to delete everything.
+ * @param[out] deletedCount   Optional: Number of values deleted.
+ *
+ * @return KVATException_ (invalidAccess) (heapError) (fetchFault) (tableError) (none)
+ */
+KVATException KVATDeletePrefix(const char* prefix, KVATSize* deletedCount);
+
+/**
+ * Returns the number of keys in storage. Kept at runtime, storage is not accessed.
+ *
+ * @param[out] count          Number of keys.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATCount(KVATSize* count);
+
+
+/**
+ * Starts keeping count of the keys that begin with a prefix. Counts one pass over the table, then kept at runtime.
+ *
+ * @param      prefix         Beginning of the keys to count. Copied.
+ *
+ * @return KVATException_ (invalidAccess) (keyDuplicate) (insufficientSpace) (heapError) (none)
+ *         insufficientSpace if all prefix counter slots are used.
+ */
+KVATException KVATRegisterPrefixCounter(const char* prefix);
+
+
+/**
+ * Stops keeping count of the keys that begin with a prefix.
+ *
+ * @param      prefix         Prefix passed to KVATRegisterPrefixCounter.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATUnregisterPrefixCounter(const char* prefix);
+
+
+/**
+ * Returns the number of keys that begin with a registered prefix. Storage is not accessed.
+ *
+ * @param      prefix         Prefix passed to KVATRegisterPrefixCounter.
+ * @param[out] count          Number of keys.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ *         notFound if the prefix is not registered.
+ */
+KVATException KVATCountPrefix(const char* prefix, KVATSize* count);
+
+
 /**
  * Searches for a key from a partial query.
  *
@@ -160,4 +559,191 @@ KVATException KVATDeleteValue(const char* key);
  */
 KVATException KVATSearch(const char* key, KVATSearchID* searchID, char* keyFound, KVATSize keyFoundMaxSize);
 
+
+/**
+ * Searches for all keys from a partial query, packing as many as fit into a buffer in a single pass.
+ * Keys are placed one after the other, each null terminated.
+ *
+ * @param      key                Beginning of the keys to search for.
+ * @param      searchID           Reference to variable to store search continuity. Initialize with INITIALID.
+ * @param[out] resultsBuffer      Buffer to pack the keys found into.
+ * @param      resultsBufferSize  Size of resultsBuffer.
+ * @param[out] resultIDs          Optional: Array (of maxResults) to store the entry of each key found.
+ *                                Passing one as searchID to KVATSearch/KVATSearchMany resumes at that key.
+ * @param      maxResults         Maximum number of keys to return.
+ * @param[out] resultCount        Optional: Number of keys placed in resultsBuffer.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (heapError) (fetchFault) (tableError) (none)
+ *         invalidAccess if resultsBuffer can't hold the next key found.
+ */
+KVATException KVATSearchMany(const char* key, KVATSearchID* searchID, char* resultsBuffer, KVATSize resultsBufferSize, KVATSearchID* resultIDs, KVATSize maxResults, KVATSize* resultCount);
+
+
+/**
+ * Finds all keys matching a pattern. Single pass over the table.
+ * Key pages are matched as they are read, so most keys are discarded on their first page by the literal beginning of the pattern.
+ * Only the keys that match are fetched whole.
+ *
+ * Pattern syntax:  ?  Any single character but '/'
+ *                  *  Any run of characters but '/' (within a single route level)
+ *                  ** Any run of characters (across route levels)
+ *
+ * @param      pattern        Pattern to match. 63 characters max.
+ * @param      callback       Function called with each key matched.
+ * @param      context        Optional: Passed to callback as is.
+ * @param[out] matchCount     Optional: Number of keys matched.
+ *
+ * @return KVATException_ (invalidAccess) (heapError) (fetchFault) (tableError) (none)
+ */
+KVATException KVATQuery(const char* pattern, KVATQueryCallback callback, void* context, KVATSize* matchCount);
+
+
+/**
+ * Subscribes to changes on a key, or on all keys that begin with a prefix.
+ * The callback is called after a save, rename or delete is committed, from inside the call that made the change.
+ * Callbacks should not modify storage.
+ *
+ * @param      key             Key (or prefix) to watch. Copied.
+ * @param      isPrefix        Pass true to watch all keys that begin with key.
+ * @param      callback        Function called on every change.
+ * @param      context         Optional: Passed to callback as is.
+ * @param[out] subscriptionID  Optional: Identifies the subscription for KVATUnsubscribe.
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (heapError) (none)
+ *         insufficientSpace if all subscription slots are used.
+ */
+KVATException KVATSubscribe(const char* key, bool isPrefix, KVATChangeCallback callback, void* context, KVATSubscriptionID* subscriptionID);
+
+
+/**
+ * Removes a subscription.
+ *
+ * @param      subscriptionID  Identifier from KVATSubscribe.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATUnsubscribe(KVATSubscriptionID subscriptionID);
+
+
+/**
+ * Lists the keys that changed after a sequence of the store, for incremental sync. Requires CHANGELOG (kvat.c).
+ * Deleted keys are listed from their tombstones. Changes are listed in table order: a key can be listed
+ * more than once (deleted, then saved again), and the change with the greatest sequence is current.
+ * Counters are always listed.
+ *
+ * @param      sequence          Sequence returned by the last sync. Pass 0 to list everything.
+ * @param      callback          Function called for every change.
+ * @param      context           Optional: Passed to callback as is.
+ * @param[out] currentSequence   Optional: Current sequence of the store. Keep it for the next sync.
+ *
+ * @return KVATException_ (invalidAccess) (historyTruncated) (tableError) (fetchFault) (heapError) (none)
+ *         historyTruncated if tombstones after sequence were reclaimed. Do a full sync (currentSequence is still set).
+ */
+KVATException KVATChangesSince(KVATSequence sequence, KVATChangesCallback callback, void* context, KVATSequence* currentSequence);
+
+
+/**
+ * Streams all keys and values into a compact backup container with a CRC-32 trailer.
+ * Keys and values are read a page at a time. Tiered values are streamed from the tier's view (read whole
+ * if the tier has none). The container can be restored with KVATImport.
+ *
+ * @param      writer          Function that receives the container, a piece at a time.
+ * @param      context         Optional: Passed to writer as is.
+ * @param[out] exportedCount   Optional: Number of keys written whole.
+ *
+ * @return KVATException_ (invalidAccess) (storageFault) (tableError) (fetchFault) (heapError) (none) ...
+ *         storageFault if writer fails. invalidAccess if a key is longer than 0xFFFF bytes.
+ */
+KVATException KVATExport(KVATExportWriter writer, void* context, KVATSize* exportedCount);
+
+
+/**
+ * Restores a backup made by KVATExport into an empty store. Pages are taken in order and the table
+ * is written a block at a time. Nothing is kept if the import fails (including a checksum mismatch).
+ * With a tier set, values that were tiered, or that are larger than its size threshold, go to the tier.
+ * Subscriptions are not notified.
+ *
+ * @param      reader          Function that provides the container, a piece at a time.
+ * @param      context         Optional: Passed to reader as is.
+ * @param[out] importedCount   Optional: Number of keys imported.
+ *
+ * @return KVATException_ (invalidAccess) (invalidFormat) (insufficientSpace) (storageFault) (tableError) (heapError) (recordFault) (none)
+ *         invalidAccess if the store has keys or a streaming write is open. storageFault if reader fails.
+ */
+KVATException KVATImport(KVATImportReader reader, void* context, KVATSize* importedCount);
+
+
+/**
+ * Sets a frozen store (generated by tools/kvatfrozen) as read-only fallback for keys not in storage.
+ * KVATRetrieveValue (and conveniences), KVATStat and KVATExists consult it. Saving a key overrides
+ * its frozen value; deleting it brings the frozen value back. Search, query, count and export only see storage.
+ * Can be called before KVATInit.
+ *
+ * @param      store         Generated frozen store (kept in flash). Pass NULL to remove.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATSetFrozenStore(const KVATFrozenStore* store);
+
+
+
+/**
+ * Sets a tier: a secondary store for values that are large or cold. A tiered value is kept in the tier,
+ * with a stub in storage that holds its size. Reads, stat, compares, deletes and export follow the stub,
+ * so the application doesn't change. Tiered keys can't be renamed (KVATChangeKey fails with invalidAccess).
+ * The tier keeps them under their key after a reserved 0x1F byte, apart from keys saved in its store directly.
+ * Can be called before KVATInit.
+ *
+ *     static const KVATTier logTier = {&KVATLogWriteOpen, &KVATLogWriteChunk, &KVATLogWriteClose,
+ *                                      &KVATLogWriteAbort, &KVATLogRetrieveValue, &KVATLogDeleteValue, 64, 1000,
+ *                                      &KVATLogRetrieveView};
+ *
+ * @param      tier          Secondary store and its policy (kept, not copied). Pass NULL to stop tiering
+ *                           (values already tiered can't be read until it's set again).
+ *
+ * @return KVATException_ (invalidAccess) (heapError) (none)
+ */
+KVATException KVATSetTier(const KVATTier* tier);
+
+
+/**
+ * Moves values that were not read or saved within the tier's coldOperations to the tier, a page at a time.
+ * Counters are not moved. Call from an idle or background task.
+ *
+ * @param[out] movedCount    Optional: Number of values moved.
+ *
+ * @return KVATException_ (invalidAccess) (tableError) (fetchFault) (insufficientSpace) (heapError) (none) ...
+ *         invalidAccess if no tier is set or a streaming write is open.
+ */
+KVATException KVATTierService(KVATSize* movedCount);
+
+
+/**
+ * Grows or shrinks the store to a number of pages (also the number of table entries), keeping every value.
+ * Pages stay where they are: a larger table takes the first pages and the store extends past the last one,
+ * a smaller store drops its last pages. Chains on pages being taken or dropped are copied to other pages,
+ * entries past a smaller table are moved into it, and the index is written last. A larger store grows in steps,
+ * so chains can be copied into the pages a step added.
+ * Short of room, tombstones are reclaimed and evictable values evicted, as on a save.
+ * If interrupted by a reset, the store keeps its size (or the size of the last step); call again with the same page count.
+ * Counter handles must be opened again.
+ *
+ * @param      newPageCount   Number of pages. 255 max.
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (tableError) (storageFault) (recordFault) (none)
+ *         invalidAccess if not initialized or a streaming write is open.
+ *         insufficientSpace if a larger store doesn't fit in storage, or the values don't fit in a smaller one.
+ */
+KVATException KVATResize(KVATSize newPageCount);
+
+/**
+ * Sets the storage the store runs on, in place of the internal EEPROM (see kvat_serial.h for external serial memories).
+ * The memory is formatted by KVATInit if it doesn't hold a store. Call before KVATInit.
+ *
+ * @param      backend       Functions to reach the memory (copied). Pass NULL to go back to the internal EEPROM.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATSetBackend(const KVATBackend* backend);
+
 #endif /* KVAT_H_ */
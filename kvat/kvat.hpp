@@ -0,0 +1,311 @@
+/*
+ * kvat.hpp
+ * KVAT - Key Value Address Table
+ * C++17 interface over kvat.h
+ *
+ * Typed get and set for trivially copyable values, keys that carry their length, and buffers passed as spans.
+ * Errors come back in a Result (value or KVATException); nothing throws and nothing on these paths allocates.
+ * Keys are matched with the ...WithKey calls, so they are never measured. A std::string_view key is copied
+ * into a buffer on the stack first (it may not be null terminated); a _key literal is passed as is.
+ * Keys known at build time (KVATKEY("..."), or a constexpr "..."_key) carry their hash, computed by the
+ * compiler, and KVAT::areDistinct checks a set of them for repeats and hash collisions in a static_assert.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+#ifndef KVAT_HPP_
+#define KVAT_HPP_
+
+extern "C" {
+#include "kvat/kvat.h"
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+
+// Longest std::string_view key that can be passed (copied to the stack). _key literals have no limit.
+#ifndef KVATKEYCOPYMAX
+#define KVATKEYCOPYMAX 64
+#endif
+
+// Key known at build time, with its hash computed by the compiler (see KVAT::Key)
+#define KVATKEY(literal) ([]{constexpr KVAT::Key key = KVAT::Key::hashed(literal, sizeof(literal)-1); return key;}())
+
+namespace KVAT {
+
+/**
+ * Hash of a key, as kvatFrozenHash(key, 0) (kvat_frozen.h), for the compiler. Must match it.
+ */
+constexpr uint32_t hashKey(const char* string, std::size_t length){
+    uint32_t hash = 2166136261u*16777619u;
+    for (std::size_t charI = 0; charI<length; charI++){
+        hash ^= (unsigned char)string[charI];
+        hash *= 16777619u;
+    }
+
+    hash ^= hash>>16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash>>13;
+    return hash;
+}
+
+// Key with its length, and its hash if known (0 if not). Built from a literal ("route/key"_key, KVATKEY("route/key")),
+// a generated key (tools/kvatkeys), or a string already null terminated at length.
+class Key{
+public:
+    constexpr Key(const char* string, KVATSize length, uint32_t hash = 0) : key{string, length, hash}{}
+    constexpr Key(const KVATKey& key) : key(key){}
+
+    static constexpr Key hashed(const char* string, std::size_t length){
+        return Key(string, (KVATSize)length, hashKey(string, length));
+    }
+
+    constexpr const char* string() const {return key.string;}
+    constexpr KVATSize length() const {return key.length;}
+    constexpr uint32_t hash() const {return key.hash;}
+    constexpr const KVATKey* get() const {return &key;}
+
+private:
+    KVATKey key;
+};
+
+inline namespace literals {
+// Hashed by the compiler where the key is a constant expression (constexpr variable, KVATKEY)
+constexpr Key operator""_key(const char* string, std::size_t length){
+    return Key::hashed(string, length);
+}
+}
+
+/**
+ * Checks that no two hashed keys of a set share a hash (a key repeated included). For a static_assert on the keys of a module.
+ *
+ * @return true if all hashes are distinct.
+ */
+template<std::size_t N>
+constexpr bool areDistinct(const Key (&keys)[N]){
+    for (std::size_t keyI = 0; keyI<N; keyI++){
+        for (std::size_t otherI = keyI+1; otherI<N; otherI++){
+            if (keys[keyI].hash()==keys[otherI].hash()){return false;}
+        }
+    }
+    return true;
+}
+
+// Bytes of a contiguous run of trivially copyable elements: an array, or a container with data() and size()
+// (std::array, std::span, std::vector...), or a pointer and a size in bytes. Span is written to, ConstSpan only read.
+template<bool isConst>
+class BasicSpan{
+public:
+    using Pointer = std::conditional_t<isConst, const void*, void*>;
+
+    constexpr BasicSpan(Pointer data, std::size_t size) : first(data), byteCount(size){}
+
+    template<typename Container, typename Element = std::remove_pointer_t<decltype(std::data(std::declval<Container&>()))>,
+             typename = std::enable_if_t<std::is_trivially_copyable_v<Element> && std::is_convertible_v<Element*, Pointer>>>
+    constexpr BasicSpan(Container&& container) : first(std::data(container)), byteCount(std::size(container)*sizeof(Element)){}
+
+    constexpr Pointer data() const {return first;}
+    constexpr std::size_t size() const {return byteCount;}     // In bytes
+
+private:
+    Pointer first;
+    std::size_t byteCount;
+};
+
+using Span = BasicSpan<false>;
+using ConstSpan = BasicSpan<true>;
+
+// Value, or the exception that kept it from being produced
+template<typename T>
+class Result{
+public:
+    constexpr Result(const T& value) : stored(value), exception(KVATException_none){}
+
+    static constexpr Result fail(KVATException exception){return Result(exception, 0);}
+
+    constexpr bool hasValue() const {return exception==KVATException_none;}
+    constexpr explicit operator bool() const {return hasValue();}
+
+    constexpr const T& value() const {return stored;}            // Only meaningful if hasValue()
+    constexpr T valueOr(const T& fallback) const {return hasValue() ? stored : fallback;}
+    constexpr KVATException error() const {return exception;}
+
+private:
+    constexpr Result(KVATException exception, int) : stored(), exception(exception){}
+
+    T stored;
+    KVATException exception;
+};
+
+// Outcome of a call that produces no value
+template<>
+class Result<void>{
+public:
+    constexpr Result(KVATException exception) : exception(exception){}
+
+    constexpr bool hasValue() const {return exception==KVATException_none;}
+    constexpr explicit operator bool() const {return hasValue();}
+    constexpr KVATException error() const {return exception;}
+
+private:
+    KVATException exception;
+};
+
+using Status = Result<void>;
+
+// Copy of a std::string_view key, null terminated on the stack
+class KeyCopy{
+public:
+    explicit KeyCopy(std::string_view view) : isValid(view.size()<=KVATKEYCOPYMAX){
+        if (isValid){
+            std::memcpy(buffer, view.data(), view.size());
+            buffer[view.size()] = '\0';
+            length = (KVATSize)view.size();
+        }
+    }
+    KeyCopy(const KeyCopy&) = delete;
+    KeyCopy& operator=(const KeyCopy&) = delete;
+
+    bool valid() const {return isValid;}
+    Key key() const {return Key(buffer, length);}
+
+private:
+    char buffer[KVATKEYCOPYMAX+1];
+    KVATSize length = 0;
+    bool isValid;
+};
+
+// The store (kvat.c). Holds no state of its own, so any number of Store objects can be used.
+class Store{
+public:
+    static Status init(){return KVATInit();}
+
+    /**
+     * Reads a value saved with set<T>. The size saved must be sizeof(T).
+     *
+     * @return Result with the value, or KVATException_ (invalidAccess) (notFound) (invalidFormat) ... See KVATRetrieveValueWithKey
+     *         invalidFormat if the value saved has another size.
+     */
+    template<typename T>
+    Result<T> get(const Key& key) const {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "get<T> reads values as bytes");
+
+        // One byte over, so a longer value fetches more than sizeof(T)
+        unsigned char bytes[sizeof(T)+1];
+        KVATSize size = 0;
+        KVATException exception = KVATRetrieveValueWithKey(key.get(), bytes, sizeof(bytes), &size);
+        if (exception!=KVATException_none){return Result<T>::fail(exception);}
+        if (size!=sizeof(T)){return Result<T>::fail(KVATException_invalidFormat);}
+
+        T value{};
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    Result<T> get(std::string_view key) const {
+        KeyCopy copy(key);
+        return copy.valid() ? get<T>(copy.key()) : Result<T>::fail(KVATException_invalidAccess);
+    }
+
+    /**
+     * Saves a value as its bytes (sizeof(T)).
+     *
+     * @return Status with KVATException_ ... See KVATSaveValueWithKey
+     */
+    template<typename T>
+    Status set(const Key& key, const T& value){
+        static_assert(std::is_trivially_copyable_v<T>, "set saves values as bytes");
+        return KVATSaveValueWithKey(key.get(), &value, sizeof(T));
+    }
+
+    template<typename T>
+    Status set(std::string_view key, const T& value){
+        KeyCopy copy(key);
+        return copy.valid() ? set(copy.key(), value) : Status(KVATException_invalidAccess);
+    }
+
+    /**
+     * Reads a value into a buffer. Values longer than the buffer are trimmed.
+     *
+     * @return Result with the size of the value in bytes (also if trimmed), or KVATException_ ... See KVATRetrieveValueWithKey
+     *         and KVATStatWithKey
+     */
+    Result<KVATSize> read(const Key& key, Span buffer) const {
+        KVATSize size = 0;
+        KVATException exception = KVATRetrieveValueWithKey(key.get(), buffer.data(), (KVATSize)buffer.size(), &size);
+        if (exception!=KVATException_none){return Result<KVATSize>::fail(exception);}
+
+        // A full buffer may hold a trimmed value: the C side reports what was fetched
+        if (size==buffer.size()){
+            exception = KVATStatWithKey(key.get(), &size, NULL);
+            if (exception!=KVATException_none){return Result<KVATSize>::fail(exception);}
+        }
+
+        return size;
+    }
+
+    Result<KVATSize> read(std::string_view key, Span buffer) const {
+        KeyCopy copy(key);
+        return copy.valid() ? read(copy.key(), buffer) : Result<KVATSize>::fail(KVATException_invalidAccess);
+    }
+
+    /**
+     * Saves the contents of a buffer as a value.
+     *
+     * @return Status with KVATException_ ... See KVATSaveValueWithKey
+     */
+    Status write(const Key& key, ConstSpan data){
+        return KVATSaveValueWithKey(key.get(), data.data(), (KVATSize)data.size());
+    }
+
+    Status write(std::string_view key, ConstSpan data){
+        KeyCopy copy(key);
+        return copy.valid() ? write(copy.key(), data) : Status(KVATException_invalidAccess);
+    }
+
+    /**
+     * Gets the size of a value without reading it.
+     *
+     * @return Result with the size in bytes, or KVATException_ ... See KVATStatWithKey
+     */
+    Result<KVATSize> size(const Key& key) const {
+        KVATSize size = 0;
+        KVATException exception = KVATStatWithKey(key.get(), &size, NULL);
+        if (exception!=KVATException_none){return Result<KVATSize>::fail(exception);}
+
+        return size;
+    }
+
+    Result<KVATSize> size(std::string_view key) const {
+        KeyCopy copy(key);
+        return copy.valid() ? size(copy.key()) : Result<KVATSize>::fail(KVATException_invalidAccess);
+    }
+
+    bool contains(const Key& key) const {return KVATStatWithKey(key.get(), NULL, NULL)==KVATException_none;}
+
+    bool contains(std::string_view key) const {
+        KeyCopy copy(key);
+        return copy.valid() && contains(copy.key());
+    }
+
+    /**
+     * Deletes a value.
+     *
+     * @return Status with KVATException_ ... See KVATDeleteValueWithKey
+     */
+    Status remove(const Key& key){return KVATDeleteValueWithKey(key.get());}
+
+    Status remove(std::string_view key){
+        KeyCopy copy(key);
+        return copy.valid() ? remove(copy.key()) : Status(KVATException_invalidAccess);
+    }
+};
+
+} // namespace KVAT
+
+#endif /* KVAT_HPP_ */
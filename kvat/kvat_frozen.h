@@ -0,0 +1,56 @@
+/*
+ * kvat_frozen.h
+ * KVAT - Key Value Address Table
+ *
+ * Frozen store: read-only keys and values kept in flash, generated at build time (tools/kvatfrozen).
+ * Keys are found through a minimal perfect hash (hash and displace), so a lookup touches a single
+ * displacement and a single entry. Shared by kvat.c and the generator.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef KVAT_FROZEN_H_
+#define KVAT_FROZEN_H_
+
+#include "kvat/kvat.h"
+
+// Key and value in a frozen store
+typedef struct KVATFrozenEntry{
+    const char* key;
+    const void* value;
+    KVATSize valueSize;
+}KVATFrozenEntry;
+
+// Frozen store. Generated, and kept const so it stays in flash.
+// A key's bucket is kvatFrozenHash(key, 0) % bucketCount.
+// Its entry is kvatFrozenHash(key, displacements[bucket]) % entryCount.
+struct KVATFrozenStore{
+    uint32_t entryCount;
+    uint32_t bucketCount;
+    const uint32_t* displacements;  // Seed per bucket
+    const KVATFrozenEntry* entries; // entryCount entries, in hash order
+};
+
+/**
+ * Seeded FNV-1a hash of a key, with a final mix so every bit counts in the modulo. Must match between generator and device.
+ *
+ * @param      key           String key.
+ * @param      seed          Mixed in before the key.
+ *
+ * @return Hash of the key.
+ */
+static inline uint32_t kvatFrozenHash(const char* key, uint32_t seed){
+    uint32_t hash = (2166136261u ^ seed) * 16777619u;
+    while (*key){
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+
+    hash ^= hash>>16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash>>13;
+    return hash;
+}
+
+#endif /* KVAT_FROZEN_H_ */
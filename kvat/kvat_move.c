@@ -0,0 +1,98 @@
+/*
+ * kvat_move.c
+ * KVAT - Key Value Address Table
+ * Moving and copying values between stores (EEPROM store in kvat.c, log store in kvatlog.c)
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat_move.h"
+#include "kvat/kvatlog.h"
+
+#define MOVECHUNKSIZE 64    // Bytes passed to the EEPROM stream per chunk
+
+/**
+ * Passes a piece of an EEPROM value to the open log stream (KVATExportWriter).
+ */
+static bool writeLogChunk(const void* data, KVATSize size, void* context){
+    return KVATLogWriteChunk(data, size)==KVATException_none;
+}
+
+/**
+ * Streams a value from the EEPROM store into the log store.
+ */
+static KVATException copyToLog(const char* key){
+    KVATSize size;
+    KVATFlags flags;
+    KVATException exception = KVATStat(key, &size, &flags);
+    if (exception!=KVATException_none){return exception;}
+    if (flags & KVATFLAG_COUNTER){return KVATException_invalidAccess;}
+
+    exception = KVATLogWriteOpen(key, size);
+    if (exception!=KVATException_none){return exception;}
+
+    exception = KVATRetrieveStream(key, &writeLogChunk, NULL, NULL);
+    if (exception!=KVATException_none){
+        KVATLogWriteAbort();    // Fails harmlessly if the chunk already discarded the stream
+        return exception;
+    }
+
+    return KVATLogWriteClose();
+}
+
+/**
+ * Streams a value from the log store into the EEPROM store, straight from flash.
+ */
+static KVATException copyToEEPROM(const char* key){
+    const void* view;
+    KVATSize size;
+    KVATException exception = KVATLogRetrieveView(key, &view, &size);
+    if (exception!=KVATException_none){return exception;}
+    if (size==0){return KVATException_invalidAccess;}
+
+    exception = KVATWriteOpen(key, size);
+    if (exception!=KVATException_none){return exception;}
+
+    for (KVATSize done = 0; done<size; ){
+        KVATSize transfer = size-done;
+        if (transfer>MOVECHUNKSIZE){transfer = MOVECHUNKSIZE;}
+
+        exception = KVATWriteChunk((const char*)view+done, transfer);
+        if (exception!=KVATException_none){return exception;}   // Stream is discarded
+
+        done += transfer;
+    }
+
+    return KVATWriteClose();
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC
+
+KVATException KVATCopy(KVATStore source, KVATStore destination, const char* key){
+    if (!key || source==destination){return KVATException_invalidAccess;}
+
+    if (source==KVATStore_eeprom && destination==KVATStore_log){return copyToLog(key);}
+    if (source==KVATStore_log && destination==KVATStore_eeprom){return copyToEEPROM(key);}
+
+    return KVATException_invalidAccess;
+}
+
+KVATException KVATMove(KVATStore source, KVATStore destination, const char* key){
+    if (!key){return KVATException_invalidAccess;}
+
+    if (source==KVATStore_eeprom){
+        // Frozen values have nothing to delete
+        KVATFlags flags;
+        KVATException statException = KVATStat(key, NULL, &flags);
+        if (statException!=KVATException_none){return statException;}
+        if (flags & KVATFLAG_FROZEN){return KVATException_invalidAccess;}
+    }
+
+    KVATException exception = KVATCopy(source, destination, key);
+    if (exception!=KVATException_none){return exception;}
+
+    // Value is committed in destination
+    return source==KVATStore_eeprom ? KVATDeleteValue(key) : KVATLogDeleteValue(key);
+}
@@ -0,0 +1,47 @@
+/*
+ * kvat_move.h
+ * KVAT - Key Value Address Table
+ * Moving and copying values between stores (EEPROM store in kvat.c, log store in kvatlog.c)
+ *
+ * Values are streamed: a page at a time out of EEPROM (KVATRetrieveStream), straight from flash out of
+ * the log (KVATLogRetrieveView), never held whole in memory. The destination commits the value in a
+ * single step before the source is touched, so a reset in between leaves the value in both stores, never in none.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef KVAT_MOVE_H_
+#define KVAT_MOVE_H_
+
+#include "kvat/kvat.h"
+
+typedef enum KVATStore{
+    KVATStore_eeprom,       // kvat.c (or the backend set with KVATSetBackend)
+    KVATStore_log           // kvatlog.c
+}KVATStore;
+
+// Prototypes ----------------------
+
+/**
+ * Copies a value from one store to the other, under the same key. Overwrites the key in the destination.
+ * Both stores need to be initialized. Counters and empty values can't be copied.
+ *
+ * @param      source        Store to copy from. Values from the frozen store are copied as well.
+ * @param      destination   Store to copy to. Must differ from source.
+ * @param      key           String tag of the value
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (insufficientSpace) (storageFault) (tableError) (fetchFault) (none)
+ */
+KVATException KVATCopy(KVATStore source, KVATStore destination, const char* key);
+
+
+/**
+ * Moves a value from one store to the other: copies it (see KVATCopy), then deletes it from the source.
+ * Frozen values can't be moved.
+ *
+ * @return KVATException_ ... See KVATCopy
+ */
+KVATException KVATMove(KVATStore source, KVATStore destination, const char* key);
+
+#endif /* KVAT_MOVE_H_ */
@@ -0,0 +1,141 @@
+/*
+ * kvat_serial.c
+ * KVAT - Key Value Address Table
+ * Backend for external serial memories (SPI FRAM or serial EEPROM with the 25-series command set)
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat_serial.h"
+
+#include <string.h>
+
+// Commands
+#define SERIALWREN  0x06    // Write enable. Needed before every write.
+#define SERIALRDSR  0x05    // Read status register
+#define SERIALREAD  0x03
+#define SERIALWRITE 0x02
+
+#define SERIALSTATUS_WIP 0x01   // Write in progress
+
+#define SERIALCOMMANDMAX 4      // Command byte and up to 3 address bytes
+
+/**
+ * Puts together a command with an address (most significant byte first).
+ *
+ * @return Size of the command in bytes.
+ */
+static uint32_t buildCommand(KVATSerialMemory* memory, uint8_t instruction, uint32_t address, uint8_t* command){
+    command[0] = instruction;
+    for (uint8_t byteI = 0; byteI<memory->addressSize; byteI++){
+        command[1+byteI] = address >> (8*(memory->addressSize-1-byteI));
+    }
+    return 1+memory->addressSize;
+}
+
+/**
+ * Reads straight from the memory, in a single transaction.
+ */
+static bool readMemory(KVATSerialMemory* memory, uint32_t address, void* data, uint32_t size){
+    uint8_t command[SERIALCOMMANDMAX];
+    uint32_t commandSize = buildCommand(memory, SERIALREAD, address, command);
+    return memory->transfer(command, commandSize, NULL, data, size, memory->context);
+}
+
+/**
+ * Waits until a write cycle is over (serial EEPROM).
+ */
+static bool waitWriteCycle(KVATSerialMemory* memory){
+    uint8_t command = SERIALRDSR;
+    for (uint32_t poll = 0; poll<KVATSERIALPOLLMAX; poll++){
+        uint8_t status;
+        if (!memory->transfer(&command, 1, NULL, &status, 1, memory->context)){return false;}
+        if (!(status & SERIALSTATUS_WIP)){return true;}
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////
+//  BACKEND
+
+static bool serialInit(void* context, uint32_t* size){
+    KVATSerialMemory* memory = context;
+    memory->burstSize = 0;
+
+    // Wait out a write that a reset could have left going
+    if (memory->writePageSize && !waitWriteCycle(memory)){return false;}
+
+    *size = memory->size;
+    return true;
+}
+
+static bool serialRead(void* context, uint32_t address, void* data, uint32_t size){
+    KVATSerialMemory* memory = context;
+    if (address+size > memory->size){return false;}
+
+    // Large reads are a burst on their own
+    if (size>KVATSERIALBURST){return readMemory(memory, address, data, size);}
+
+    // Load a burst from this address on, unless it is already in
+    if (!memory->burstSize || address<memory->burstAddress || address+size > memory->burstAddress+memory->burstSize){
+        uint32_t burstSize = memory->size-address;
+        if (burstSize>KVATSERIALBURST){burstSize = KVATSERIALBURST;}
+
+        memory->burstSize = 0;
+        if (!readMemory(memory, address, memory->burst, burstSize)){return false;}
+        memory->burstAddress = address;
+        memory->burstSize = burstSize;
+    }
+
+    memcpy(data, memory->burst+(address-memory->burstAddress), size);
+    return true;
+}
+
+static bool serialProgram(void* context, uint32_t address, const void* data, uint32_t size){
+    KVATSerialMemory* memory = context;
+    if (address+size > memory->size){return false;}
+
+    // Keep the burst in step with the memory
+    if (memory->burstSize && address<memory->burstAddress+memory->burstSize && address+size>memory->burstAddress){
+        memory->burstSize = 0;
+    }
+
+    uint8_t writeEnable = SERIALWREN;
+    uint8_t command[SERIALCOMMANDMAX];
+
+    for (uint32_t done = 0; done<size; ){
+        // Serial EEPROMs wrap within a write page, so a transaction can't cross one
+        uint32_t transfer = size-done;
+        if (memory->writePageSize){
+            uint32_t pageRemains = memory->writePageSize - (address+done)%memory->writePageSize;
+            if (transfer>pageRemains){transfer = pageRemains;}
+        }
+
+        uint32_t commandSize = buildCommand(memory, SERIALWRITE, address+done, command);
+        if (!memory->transfer(&writeEnable, 1, NULL, NULL, 0, memory->context)){return false;}
+        if (!memory->transfer(command, commandSize, (const uint8_t*)data+done, NULL, transfer, memory->context)){return false;}
+        if (memory->writePageSize && !waitWriteCycle(memory)){return false;}
+
+        done += transfer;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC
+
+KVATException KVATSerialBackend(KVATSerialMemory* memory, KVATBackend* backend){
+    if (!memory || !backend || !memory->transfer){return KVATException_invalidAccess;}
+    if (memory->addressSize<2 || memory->addressSize>3){return KVATException_invalidAccess;}
+
+    memory->burstSize = 0;
+
+    backend->init = &serialInit;
+    backend->read = &serialRead;
+    backend->program = &serialProgram;
+    backend->context = memory;
+
+    return KVATException_none;
+}
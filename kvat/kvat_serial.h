@@ -0,0 +1,60 @@
+/*
+ * kvat_serial.h
+ * KVAT - Key Value Address Table
+ * Backend for external serial memories (SPI FRAM or serial EEPROM with the 25-series command set)
+ *
+ * The memory is reached through a bus-transfer callback supplied by the board, so the backend doesn't
+ * depend on a particular SPI peripheral. Every read or program is a single bus transaction (split at the
+ * write page boundary on serial EEPROMs, which then wait for the write cycle; FRAM has none).
+ * Small reads go through a burst buffer: a chain with contiguous pages, or a run of table entries,
+ * is read with one transaction per burst instead of one per page.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef KVAT_SERIAL_H_
+#define KVAT_SERIAL_H_
+
+#include "kvat/kvat.h"
+
+#define KVATSERIALBURST 32          // Size of the burst read buffer in bytes. Larger saves transactions, but reads more that goes unused.
+#define KVATSERIALPOLLMAX 100000    // Status polls while waiting for a write cycle before failing
+
+// Bus transfer, in one transaction (chip select held throughout). Sends commandSize bytes of command,
+// then either sends dataSize bytes from txData or receives dataSize bytes into rxData (the one not NULL).
+// Return false on failure.
+typedef bool (*KVATSerialTransfer)(const uint8_t* command, uint32_t commandSize, const void* txData, void* rxData, uint32_t dataSize, void* context);
+
+// Serial memory. Keep it alive (static) while the store runs on it.
+typedef struct KVATSerialMemory{
+    KVATSerialTransfer transfer;
+    void* context;                  // Optional: Passed to transfer as is
+    uint32_t size;                  // Size of the memory in bytes
+    uint8_t addressSize;            // Address bytes sent in commands (2 up to 64KB, 3 above)
+    uint16_t writePageSize;         // Write page of a serial EEPROM in bytes. 0 for FRAM (no pages, no write cycle).
+
+    // Internal: burst buffer
+    uint32_t burstAddress;
+    uint32_t burstSize;             // 0 if empty
+    uint8_t burst[KVATSERIALBURST];
+}KVATSerialMemory;
+
+// Prototypes ----------------------
+
+/**
+ * Prepares a backend that runs the store on a serial memory. Pass it to KVATSetBackend before KVATInit.
+ *
+ *     static KVATSerialMemory fram = {.transfer = &spiTransfer, .size = 32768, .addressSize = 2};
+ *     KVATBackend backend;
+ *     KVATSerialBackend(&fram, &backend);
+ *     KVATSetBackend(&backend);
+ *
+ * @param      memory        Serial memory, with transfer, size, addressSize and writePageSize set.
+ * @param[out] backend       Backend to pass to KVATSetBackend.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATSerialBackend(KVATSerialMemory* memory, KVATBackend* backend);
+
+#endif /* KVAT_SERIAL_H_ */
@@ -0,0 +1,910 @@
+/*
+ * kvatlog.c
+ * KVAT - Key Value Address Table
+ * Log-structured store for internal flash (erase-before-write media)
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvatlog.h"
+#include "kvat/kvat_frozen.h"   // Key hash
+
+#include <string.h>
+#include <driverlib/flash.h>
+
+#include "driverlib/rom.h"      // To use TivaWare contained in ROM
+#include "driverlib/rom_map.h"  //
+
+//==========================================================
+// REGION
+
+#define LOGSTART 0x000C0000     // Flash address of the log region. Sector aligned, outside of the program image.
+#define LOGSECTORSIZE 0x4000    // Size of an erase sector in bytes (16KB on TM4C129)
+#define LOGSECTORCOUNT 8        // Number of sectors in the region. At least LOGCLEANRESERVE+2.
+
+#ifndef FLASHMAP
+#define FLASHMAP(address) ((const void*)(address))  // Internal flash is read where it's mapped
+#endif
+
+//==========================================================
+// LIMITS
+
+#define LOGKEYMAX 64                // Maximum number of live keys (size of the table in RAM)
+#define LOGCHECKPOINTINTERVAL 32    // Records appended between checkpoints. Bounds the replay at init.
+#define LOGCLEANRESERVE 1           // Erased sectors kept for the cleaner to move live records into
+#define LOGCLEANRATIO 50            // Sectors with less live data than this (percent) are worth cleaning
+#define LOGPOOLWATERMARK 3          // Erased sectors KVATLogService keeps ready (reserve included)
+#define LOGPROGRAMWORDS 32          // Words per program operation (size of the staging buffer)
+
+//==========================================================
+// FORMAT
+
+#define LOGSECTORMAGIC  0x474C564B  // 'KVLG'. First word of a sector in use.
+#define LOGCOMMIT       0x0000A5A5  // Commit word of a complete record. Programmed last.
+#define LOGERASED       0xFFFFFFFF  // Word as left by an erase
+
+// Record types
+#define LOGRECORD_VALUE         0x01
+#define LOGRECORD_DELETE        0x02    // Key, no value
+#define LOGRECORD_CHECKPOINT    0x03    // No key. Value holds the offsets of all live records.
+
+// Sector header. Programmed when a sector starts being used.
+// Multiple of 4
+typedef struct LogSectorHeader{
+    uint32_t magic;
+    uint32_t sequence;      // Order in which sectors were started. Newest is greatest.
+}LogSectorHeader;
+
+// Record header. Followed by the key and the value, each padded to a word.
+// Multiple of 4
+typedef struct LogRecordHeader{
+    uint32_t commit;        // LOGCOMMIT once key and value are programmed. Erased if the write was interrupted.
+    uint16_t keySize;       // Including terminator
+    uint16_t valueSize;
+    uint8_t type;
+    uint8_t reserved[3];
+}LogRecordHeader;
+
+// Live key in the table
+typedef struct LogEntry{
+    uint32_t hash;          // kvatFrozenHash(key, 0)
+    uint32_t offset;        // Offset of the newest record of the key in the region. 0 if entry is free.
+}LogEntry;
+
+//==========================================================
+
+static bool didInit = false;
+static LogEntry table[LOGKEYMAX];
+static uint32_t sectorSequence[LOGSECTORCOUNT];     // Sequence from the sector header. 0 if sector is erased.
+static uint32_t sectorWritten[LOGSECTORCOUNT];      // Bytes used in the sector (header included)
+static uint32_t sectorLive[LOGSECTORCOUNT];         // Bytes of live records in the sector
+static bool sectorIsStale[LOGSECTORCOUNT];          // Cleaned, nothing refers to it. Waiting to be erased.
+static uint32_t activeSector = LOGSECTORCOUNT;      // Sector records are appended to. LOGSECTORCOUNT if none.
+static uint32_t writeOffset = 0;                    // Offset where the next record goes
+static uint32_t lastSequence = 0;                   // Sequence of the newest sector
+static uint32_t recordsSinceCheckpoint = 0;
+static bool isCleaning = false;                     // Cleaner is moving records. It may take the reserve.
+static bool isCheckpointing = false;                // Checkpoint is being appended. No cleaning meanwhile (a clean writes one).
+
+static uint32_t streamOffset = 0;                   // Record being written through KVATLogWriteChunk. 0 if no stream is open.
+static uint32_t streamSize = 0;                     // Size of the value expected
+static uint32_t streamWritten = 0;                  // Bytes of the value received (programmed, or held in streamTail)
+static uint8_t streamTail[4];                       // Bytes received past the last whole word
+
+static KVATException cleanSector(bool isForced, bool* didClean);
+
+//////////////////////////////////////////////////////////////////
+//  FLASH
+
+static uint32_t alignWord(uint32_t size){
+    return (size+3) & ~3u;
+}
+
+static uint32_t getSectorStart(uint32_t sector){
+    return sector*LOGSECTORSIZE;
+}
+
+static uint32_t getSectorOf(uint32_t offset){
+    return offset/LOGSECTORSIZE;
+}
+
+/**
+ * Programs bytes into erased flash, a staging buffer at a time (source doesn't need to be aligned, and can be in flash).
+ * A partial last word is padded with erased bits.
+ *
+ * @param      offset        Offset in the region (word aligned).
+ * @param      data          Data to program.
+ * @param      size          Size of data in bytes.
+ *
+ * @return boolean of operation result. true on success.
+ */
+static uint32_t programStage[LOGPROGRAMWORDS];     // Staging buffer of programBytes. Kept off the stack, as an inline clean runs deep in a save.
+
+static bool programBytes(uint32_t offset, const void* data, uint32_t size){
+    for (uint32_t done = 0; done<size; ){
+        uint32_t transfer = size-done;
+        if (transfer>sizeof(programStage)){transfer = sizeof(programStage);}
+
+        memset(programStage, 0xFF, sizeof(programStage));
+        memcpy(programStage, (const char*)data+done, transfer);
+
+        if (MAP_FlashProgram(programStage, LOGSTART+offset+done, alignWord(transfer))!=0){return false;}
+        done += transfer;
+    }
+
+    return true;
+}
+
+/**
+ * Erases a sector and marks it as free.
+ *
+ * @return boolean of operation result. true on success.
+ */
+static bool eraseSector(uint32_t sector){
+    if (MAP_FlashErase(LOGSTART+getSectorStart(sector))!=0){return false;}
+
+    sectorSequence[sector] = 0;
+    sectorWritten[sector] = 0;
+    sectorLive[sector] = 0;
+    sectorIsStale[sector] = false;
+
+    return true;
+}
+
+/**
+ * Erases one stale sector, returning it to the pool.
+ *
+ * @param[out] didErase      Set to true if there was a stale sector.
+ *
+ * @return KVATException_ (storageFault) (none)
+ */
+static KVATException eraseStaleSector(bool* didErase){
+    *didErase = false;
+
+    for (uint32_t sector = 0; sector<LOGSECTORCOUNT; sector++){
+        if (sectorIsStale[sector]){
+            if (!eraseSector(sector)){return KVATException_storageFault;}
+            *didErase = true;
+            break;
+        }
+    }
+
+    return KVATException_none;
+}
+
+/**
+ * Checks if every word of a sector is erased.
+ */
+static bool isSectorErased(uint32_t sector){
+    const uint32_t* words = FLASHMAP(LOGSTART+getSectorStart(sector));
+    for (uint32_t wordI = 0; wordI<LOGSECTORSIZE/4; wordI++){
+        if (words[wordI]!=LOGERASED){return false;}
+    }
+    return true;
+}
+
+static uint32_t getErasedSectorCount(){
+    uint32_t count = 0;
+    for (uint32_t sector = 0; sector<LOGSECTORCOUNT; sector++){
+        if (sectorSequence[sector]==0){count++;}
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////
+//  RECORDS
+
+static const LogRecordHeader* getRecord(uint32_t offset){
+    return FLASHMAP(LOGSTART+offset);
+}
+
+static uint32_t getRecordSize(const LogRecordHeader* record){
+    return sizeof(LogRecordHeader)+alignWord(record->keySize)+alignWord(record->valueSize);
+}
+
+static const char* getRecordKey(const LogRecordHeader* record){
+    return (const char*)(record+1);
+}
+
+static const void* getRecordValue(const LogRecordHeader* record){
+    return (const char*)(record+1)+alignWord(record->keySize);
+}
+
+/**
+ * Checks for a record at an offset of a sector.
+ *
+ * @param      offset        Offset in the region where a record could start.
+ *
+ * @return Size of the record. 0 if the rest of the sector is not written (or the header is torn).
+ */
+static uint32_t checkRecord(uint32_t offset){
+    uint32_t sectorEnd = getSectorStart(getSectorOf(offset))+LOGSECTORSIZE;
+    if (offset+sizeof(LogRecordHeader) > sectorEnd){return 0;}
+
+    const LogRecordHeader* record = getRecord(offset);
+    if (record->keySize==0xFFFF && record->valueSize==0xFFFF){return 0;}
+
+    uint32_t size = getRecordSize(record);
+    if (offset+size > sectorEnd){return 0;}
+
+    return size;
+}
+
+/**
+ * Starts appending into an erased sector from the pool. Erasing is left to KVATLogService, unless the pool
+ * is down to the reserve: then stale sectors are erased (cleaning first if there are none) before going on.
+ *
+ * @return KVATException_ (insufficientSpace) (storageFault) (none)
+ */
+static KVATException openSector(){
+    // Keep the reserve for the cleaner
+    for (uint32_t attempt = 0; !isCleaning && !isCheckpointing && attempt<2*LOGSECTORCOUNT && getErasedSectorCount()<=LOGCLEANRESERVE; attempt++){
+        bool didErase = false;
+        KVATException exception = eraseStaleSector(&didErase);
+        if (exception!=KVATException_none){return exception;}
+        if (didErase){continue;}
+
+        bool didClean = false;
+        exception = cleanSector(true, &didClean);
+        if (exception!=KVATException_none){return exception;}
+        if (!didClean){break;}
+    }
+    if (getErasedSectorCount() <= (isCleaning ? 0 : LOGCLEANRESERVE)){return KVATException_insufficientSpace;}
+
+    uint32_t sector = 0;
+    while (sectorSequence[sector]!=0){sector++;}
+
+    LogSectorHeader header = {.magic = LOGSECTORMAGIC, .sequence = lastSequence+1};
+    if (!programBytes(getSectorStart(sector), &header, sizeof(header))){return KVATException_storageFault;}
+
+    lastSequence = header.sequence;
+    sectorSequence[sector] = header.sequence;
+    sectorWritten[sector] = sizeof(header);
+    sectorLive[sector] = 0;
+
+    activeSector = sector;
+    writeOffset = getSectorStart(sector)+sizeof(header);
+
+    return KVATException_none;
+}
+
+/**
+ * Checks if a record of a size fits in what is left of the active sector.
+ */
+static bool doesRecordFit(uint32_t size){
+    return activeSector!=LOGSECTORCOUNT && writeOffset+size <= getSectorStart(activeSector)+LOGSECTORSIZE;
+}
+
+/**
+ * Starts a record at the end of the log: takes its space and programs the header (all but the commit word) and the key.
+ * Moves to a new sector if the record doesn't fit in the active one.
+ *
+ * @param[out] offset        Offset of the record.
+ *
+ * @return KVATException_ (insufficientSpace) (storageFault) (none)
+ */
+static KVATException beginRecord(uint8_t type, const char* key, uint32_t keySize, uint32_t valueSize, uint32_t* offset){
+    LogRecordHeader header = {.commit = LOGERASED, .keySize = keySize, .valueSize = valueSize, .type = type, .reserved = {0xFF, 0xFF, 0xFF}};
+    uint32_t size = getRecordSize(&header);
+    if (size > LOGSECTORSIZE-sizeof(LogSectorHeader)){return KVATException_insufficientSpace;}
+
+    if (!doesRecordFit(size)){
+        KVATException openException = openSector();
+        if (openException!=KVATException_none){return openException;}
+    }
+
+    // Space is taken even if programming fails
+    uint32_t recordOffset = writeOffset;
+    writeOffset += size;
+    sectorWritten[activeSector] = writeOffset-getSectorStart(activeSector);
+
+    bool didProgram = programBytes(recordOffset+sizeof(uint32_t), (const char*)&header+sizeof(uint32_t), sizeof(header)-sizeof(uint32_t))
+                   && programBytes(recordOffset+sizeof(header), key, keySize);
+    if (!didProgram){return KVATException_storageFault;}
+
+    *offset = recordOffset;
+    return KVATException_none;
+}
+
+/**
+ * Programs the commit word of a record. Until then, the record is skipped at init.
+ *
+ * @return boolean of operation result. true on success.
+ */
+static bool commitRecord(uint32_t offset){
+    uint32_t commit = LOGCOMMIT;
+    return programBytes(offset, &commit, sizeof(commit));
+}
+
+/**
+ * Appends a complete record at the end of the log. Header goes first, then key and value, then the commit word.
+ *
+ * @param[out] offset        Offset of the record appended.
+ *
+ * @return KVATException_ ... See beginRecord
+ */
+static KVATException appendRecord(uint8_t type, const char* key, uint32_t keySize, const void* value, uint32_t valueSize, uint32_t* offset){
+    uint32_t recordOffset;
+    KVATException exception = beginRecord(type, key, keySize, valueSize, &recordOffset);
+    if (exception!=KVATException_none){return exception;}
+
+    if (!programBytes(recordOffset+sizeof(LogRecordHeader)+alignWord(keySize), value, valueSize) || !commitRecord(recordOffset)){
+        return KVATException_storageFault;
+    }
+
+    *offset = recordOffset;
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  TABLE
+
+/**
+ * Looks for the table entry of a key.
+ *
+ * @return Index of the entry, or LOGKEYMAX if not found.
+ */
+static uint32_t findEntry(const char* key, uint32_t hash){
+    for (uint32_t entryI = 0; entryI<LOGKEYMAX; entryI++){
+        if (table[entryI].offset && table[entryI].hash==hash && strcmp(getRecordKey(getRecord(table[entryI].offset)), key)==0){
+            return entryI;
+        }
+    }
+    return LOGKEYMAX;
+}
+
+static uint32_t findFreeEntry(){
+    uint32_t entryI = 0;
+    while (entryI<LOGKEYMAX && table[entryI].offset){entryI++;}
+    return entryI;
+}
+
+/**
+ * Counts a record as live (or not) in its sector.
+ */
+static void setRecordLive(uint32_t offset, bool isLive){
+    uint32_t size = getRecordSize(getRecord(offset));
+    if (isLive){
+        sectorLive[getSectorOf(offset)] += size;
+    }else{
+        sectorLive[getSectorOf(offset)] -= size;
+    }
+}
+
+/**
+ * Points an entry to a new record (releasing the old one).
+ */
+static void setEntryRecord(uint32_t entryI, uint32_t hash, uint32_t offset){
+    if (table[entryI].offset){
+        setRecordLive(table[entryI].offset, false);
+    }
+
+    table[entryI].hash = hash;
+    table[entryI].offset = offset;
+
+    if (offset){
+        setRecordLive(offset, true);
+    }
+}
+
+/**
+ * Applies a committed record to the table, as it was when the record was appended. Used to rebuild at init.
+ */
+static void replayRecord(uint32_t offset){
+    const LogRecordHeader* record = getRecord(offset);
+
+    if (record->type==LOGRECORD_CHECKPOINT){
+        // Table is exactly what the checkpoint holds
+        memset(table, 0, sizeof(table));
+        memset(sectorLive, 0, sizeof(sectorLive));
+
+        const uint32_t* liveOffsets = getRecordValue(record);
+        for (uint32_t liveI = 0; liveI<record->valueSize/sizeof(uint32_t) && liveI<LOGKEYMAX; liveI++){
+            setEntryRecord(liveI, kvatFrozenHash(getRecordKey(getRecord(liveOffsets[liveI])), 0), liveOffsets[liveI]);
+        }
+        return;
+    }
+
+    const char* key = getRecordKey(record);
+    uint32_t hash = kvatFrozenHash(key, 0);
+    uint32_t entryI = findEntry(key, hash);
+
+    if (record->type==LOGRECORD_VALUE){
+        if (entryI==LOGKEYMAX){entryI = findFreeEntry();}
+        if (entryI<LOGKEYMAX){
+            setEntryRecord(entryI, hash, offset);
+        }
+    }else if (record->type==LOGRECORD_DELETE && entryI<LOGKEYMAX){
+        setEntryRecord(entryI, 0, 0);
+    }
+}
+
+static uint32_t checkpointOffsets[LOGKEYMAX];       // Value of the checkpoint being appended (writeCheckpoint, never nested)
+
+/**
+ * Appends a checkpoint with the offsets of all live records. Records before it are no longer needed at init.
+ * If the checkpoint needs a new sector and only a clean would free one, the clean is done instead (it writes
+ * the checkpoint). Sectors are not cleaned while the checkpoint is appended, so checkpoints never nest.
+ *
+ * @return KVATException_ ... See appendRecord and cleanSector
+ */
+static KVATException writeCheckpoint(){
+    uint32_t liveCount = 0;
+    for (uint32_t entryI = 0; entryI<LOGKEYMAX; entryI++){
+        if (table[entryI].offset){
+            checkpointOffsets[liveCount++] = table[entryI].offset;
+        }
+    }
+
+    LogRecordHeader header = {.keySize = 0, .valueSize = liveCount*sizeof(uint32_t)};
+    if (!isCleaning && !doesRecordFit(getRecordSize(&header))){
+        bool didErase = true;
+        while (didErase && getErasedSectorCount()<=LOGCLEANRESERVE){
+            KVATException exception = eraseStaleSector(&didErase);
+            if (exception!=KVATException_none){return exception;}
+        }
+
+        if (getErasedSectorCount()<=LOGCLEANRESERVE){
+            bool didClean;
+            return cleanSector(true, &didClean);
+        }
+    }
+
+    isCheckpointing = true;
+    uint32_t offset;
+    KVATException exception = appendRecord(LOGRECORD_CHECKPOINT, NULL, 0, checkpointOffsets, liveCount*sizeof(uint32_t), &offset);
+    isCheckpointing = false;
+
+    if (exception==KVATException_none){
+        recordsSinceCheckpoint = 0;
+    }
+
+    return exception;
+}
+
+/**
+ * Counts an appended record towards the next checkpoint, and writes it when due.
+ * A failed checkpoint is tried again on the next record (the record itself is committed).
+ */
+static void noteRecordAppended(){
+    if (++recordsSinceCheckpoint>=LOGCHECKPOINTINTERVAL){
+        writeCheckpoint();
+    }
+}
+
+//////////////////////////////////////////////////////////////////
+//  CLEANER
+
+/**
+ * Reclaims the sector with the lowest ratio of live data. Live records are appended again,
+ * then a checkpoint is written so nothing refers to the sector, and the sector is left stale to be erased.
+ *
+ * @param      isForced      Clean even if the ratio is not below LOGCLEANRATIO (as long as something is reclaimed).
+ * @param[out] didClean      Set to true if a sector was reclaimed.
+ *
+ * @return KVATException_ (insufficientSpace) (storageFault) (none)
+ *         insufficientSpace if forced and every sector is fully live.
+ */
+static KVATException cleanSector(bool isForced, bool* didClean){
+    *didClean = false;
+
+    uint32_t victim = LOGSECTORCOUNT;
+    uint32_t victimRatio = 100;
+    for (uint32_t sector = 0; sector<LOGSECTORCOUNT; sector++){
+        if (sectorSequence[sector]==0 || sectorIsStale[sector] || sector==activeSector){continue;}
+
+        // Rounded up: a sector that is all but fully live counts as 100 and is never picked.
+        // Cleaning it would cost an erase and free next to nothing.
+        uint32_t dataSize = sectorWritten[sector]-sizeof(LogSectorHeader);
+        uint32_t ratio = dataSize ? (sectorLive[sector]*100+dataSize-1)/dataSize : 0;
+        if (ratio<victimRatio){
+            victim = sector;
+            victimRatio = ratio;
+        }
+    }
+
+    if (victim==LOGSECTORCOUNT){return isForced ? KVATException_insufficientSpace : KVATException_none;}   // Nothing would be reclaimed
+    if (!isForced && victimRatio>=LOGCLEANRATIO){return KVATException_none;}  // Not worth it yet
+
+    isCleaning = true;
+    KVATException exception = KVATException_none;
+
+    // Move live records out
+    for (uint32_t entryI = 0; entryI<LOGKEYMAX && exception==KVATException_none; entryI++){
+        if (!table[entryI].offset || getSectorOf(table[entryI].offset)!=victim){continue;}
+
+        const LogRecordHeader* record = getRecord(table[entryI].offset);
+        uint32_t offset;
+        exception = appendRecord(LOGRECORD_VALUE, getRecordKey(record), record->keySize, getRecordValue(record), record->valueSize, &offset);
+        if (exception==KVATException_none){
+            setEntryRecord(entryI, table[entryI].hash, offset);
+        }
+    }
+
+    if (exception==KVATException_none){
+        exception = writeCheckpoint();
+    }
+
+    if (exception==KVATException_none){
+        sectorIsStale[victim] = true;
+        *didClean = true;
+    }
+
+    isCleaning = false;
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC
+
+KVATException KVATLogSaveValue(const char* key, const void* value, KVATSize valueSize){
+    if (!didInit || streamOffset || !key || (!value && valueSize)){return KVATException_invalidAccess;}
+
+    KVATSize keySize = strlen(key)+1;
+    if (keySize>0xFFFF || valueSize>0xFFFF){return KVATException_invalidAccess;}
+
+    uint32_t hash = kvatFrozenHash(key, 0);
+    uint32_t entryI = findEntry(key, hash);
+
+    if (entryI<LOGKEYMAX){
+        // Same value is already there
+        const LogRecordHeader* record = getRecord(table[entryI].offset);
+        if (record->valueSize==valueSize && memcmp(getRecordValue(record), value, valueSize)==0){return KVATException_none;}
+    }else{
+        entryI = findFreeEntry();
+        if (entryI==LOGKEYMAX){return KVATException_insufficientSpace;}
+    }
+
+    uint32_t offset;
+    KVATException exception = appendRecord(LOGRECORD_VALUE, key, keySize, value, valueSize, &offset);
+    if (exception!=KVATException_none){return exception;}
+
+    setEntryRecord(entryI, hash, offset);
+    noteRecordAppended();
+
+    return KVATException_none;
+}
+
+/**
+ * Reads the value of a table entry already looked up by the caller. Same modes as KVATLogRetrieveValue.
+ *
+ * @param      entryI         Entry of the key, or LOGKEYMAX if not found.
+ *
+ * @return KVATException_ (notFound) (heapError) (none)
+ */
+static KVATException retrieveEntryValue(uint32_t entryI, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    if (retrievePointerRef!=NULL){
+        *retrievePointerRef = NULL;
+    }
+
+    if (entryI==LOGKEYMAX){return KVATException_notFound;}
+
+    const LogRecordHeader* record = getRecord(table[entryI].offset);
+    char* value = retrieveBuffer;
+    KVATSize copySize = record->valueSize;
+
+    if (value!=NULL){
+        // Trim to buffer, null terminate if there is room
+        if (copySize>retrieveBufferSize){copySize = retrieveBufferSize;}
+        if (copySize<retrieveBufferSize){value[copySize] = '\0';}
+    }else{
+        value = malloc(copySize+1);
+        if (value==NULL){return KVATException_heapError;}
+        value[copySize] = '\0';
+    }
+    memcpy(value, getRecordValue(record), copySize);
+
+    if (size!=NULL){
+        *size = record->valueSize;
+    }
+
+    if (retrievePointerRef!=NULL){
+        *retrievePointerRef = value;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATLogRetrieveValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size){
+    if (!didInit || !key){return KVATException_invalidAccess;}
+
+    uint32_t entryI = findEntry(key, kvatFrozenHash(key, 0));
+
+    return retrieveEntryValue(entryI, retrieveBuffer, retrieveBufferSize, retrievePointerRef, size);
+}
+
+KVATException KVATLogRetrieveValueWithKey(const KVATKey* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size){
+    if (!didInit || !key || !key->string || !retrieveBuffer){return KVATException_invalidAccess;}
+
+    uint32_t entryI = findEntry(key->string, key->hash ? key->hash : kvatFrozenHash(key->string, 0));
+
+    return retrieveEntryValue(entryI, retrieveBuffer, retrieveBufferSize, NULL, size);
+}
+
+/**
+ * Points to the value of a table entry already looked up by the caller.
+ *
+ * @param      entryI         Entry of the key, or LOGKEYMAX if not found.
+ *
+ * @return KVATException_ (notFound) (none)
+ */
+static KVATException viewEntryValue(uint32_t entryI, const void** view, KVATSize* size){
+    *view = NULL;
+
+    if (entryI==LOGKEYMAX){return KVATException_notFound;}
+
+    const LogRecordHeader* record = getRecord(table[entryI].offset);
+    *view = getRecordValue(record);
+    if (size!=NULL){
+        *size = record->valueSize;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATLogRetrieveView(const char* key, const void** view, KVATSize* size){
+    if (!didInit || !key || !view){return KVATException_invalidAccess;}
+
+    return viewEntryValue(findEntry(key, kvatFrozenHash(key, 0)), view, size);
+}
+
+KVATException KVATLogRetrieveViewWithKey(const KVATKey* key, const void** view, KVATSize* size){
+    if (!didInit || !key || !key->string || !view){return KVATException_invalidAccess;}
+
+    return viewEntryValue(findEntry(key->string, key->hash ? key->hash : kvatFrozenHash(key->string, 0)), view, size);
+}
+
+KVATException KVATLogDeleteValue(const char* key){
+    if (!didInit || streamOffset || !key){return KVATException_invalidAccess;}
+
+    uint32_t entryI = findEntry(key, kvatFrozenHash(key, 0));
+    if (entryI==LOGKEYMAX){return KVATException_notFound;}
+
+    uint32_t offset;
+    KVATException exception = appendRecord(LOGRECORD_DELETE, key, strlen(key)+1, NULL, 0, &offset);
+    if (exception!=KVATException_none){return exception;}
+
+    setEntryRecord(entryI, 0, 0);
+    noteRecordAppended();
+
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC STREAMING
+
+/**
+ * Offset where the value of the open stream goes.
+ */
+static uint32_t getStreamValueOffset(){
+    return streamOffset+sizeof(LogRecordHeader)+alignWord(getRecord(streamOffset)->keySize);
+}
+
+KVATException KVATLogWriteOpen(const char* key, KVATSize expectedSize){
+    if (!didInit || streamOffset || !key){return KVATException_invalidAccess;}
+
+    KVATSize keySize = strlen(key)+1;
+    if (keySize>0xFFFF || expectedSize>0xFFFF){return KVATException_invalidAccess;}
+
+    // Key needs an entry at close
+    if (findEntry(key, kvatFrozenHash(key, 0))==LOGKEYMAX && findFreeEntry()==LOGKEYMAX){return KVATException_insufficientSpace;}
+
+    uint32_t offset;
+    KVATException exception = beginRecord(LOGRECORD_VALUE, key, keySize, expectedSize, &offset);
+    if (exception!=KVATException_none){return exception;}
+
+    streamOffset = offset;
+    streamSize = expectedSize;
+    streamWritten = 0;
+
+    return KVATException_none;
+}
+
+KVATException KVATLogWriteChunk(const void* chunk, KVATSize chunkSize){
+    if (!didInit || !streamOffset || (!chunk && chunkSize)){return KVATException_invalidAccess;}
+    if (streamWritten+chunkSize > streamSize){return KVATException_invalidAccess;}
+
+    const uint8_t* bytes = chunk;
+    uint32_t valueOffset = getStreamValueOffset();
+
+    while (chunkSize){
+        uint32_t tailSize = streamWritten%4;
+        bool didProgram = true;
+        uint32_t transfer;
+
+        if (tailSize || chunkSize<4){
+            // Gather a whole word
+            transfer = 4-tailSize;
+            if (transfer>chunkSize){transfer = chunkSize;}
+            memcpy(streamTail+tailSize, bytes, transfer);
+            if (tailSize+transfer==4){
+                didProgram = programBytes(valueOffset+streamWritten-tailSize, streamTail, 4);
+            }
+        }else{
+            transfer = chunkSize & ~3u;
+            didProgram = programBytes(valueOffset+streamWritten, bytes, transfer);
+        }
+
+        if (!didProgram){
+            streamOffset = 0;   // Record stays uncommitted
+            return KVATException_storageFault;
+        }
+
+        streamWritten += transfer;
+        bytes += transfer;
+        chunkSize -= transfer;
+    }
+
+    return KVATException_none;
+}
+
+KVATException KVATLogWriteClose(){
+    if (!didInit || !streamOffset){return KVATException_invalidAccess;}
+
+    uint32_t offset = streamOffset;
+    uint32_t valueOffset = getStreamValueOffset();
+    streamOffset = 0;
+
+    // Stream must be complete to commit
+    if (streamWritten!=streamSize){return KVATException_invalidAccess;}
+
+    uint32_t tailSize = streamWritten%4;
+    if (tailSize){
+        memset(streamTail+tailSize, 0xFF, 4-tailSize);
+        if (!programBytes(valueOffset+streamWritten-tailSize, streamTail, 4)){
+            return KVATException_storageFault;
+        }
+    }
+
+    if (!commitRecord(offset)){return KVATException_storageFault;}
+
+    const char* key = getRecordKey(getRecord(offset));
+    uint32_t hash = kvatFrozenHash(key, 0);
+    uint32_t entryI = findEntry(key, hash);
+    if (entryI==LOGKEYMAX){entryI = findFreeEntry();}
+
+    setEntryRecord(entryI, hash, offset);
+    noteRecordAppended();
+
+    return KVATException_none;
+}
+
+KVATException KVATLogWriteAbort(){
+    if (!didInit || !streamOffset){return KVATException_invalidAccess;}
+
+    // Uncommitted record is skipped at init, and its space reclaimed by the cleaner
+    streamOffset = 0;
+
+    return KVATException_none;
+}
+
+//////////////////////////////////////////////////////////////////
+//  PUBLIC MAINTENANCE
+
+KVATException KVATLogClean(bool* didClean){
+    if (!didInit || streamOffset){return KVATException_invalidAccess;}
+
+    bool didCleanSector;
+    KVATException exception = cleanSector(getErasedSectorCount()<=LOGCLEANRESERVE, &didCleanSector);
+
+    bool didErase = true;
+    while (exception==KVATException_none && didErase){
+        exception = eraseStaleSector(&didErase);
+    }
+
+    if (didClean!=NULL){
+        *didClean = didCleanSector;
+    }
+
+    return exception;
+}
+
+KVATException KVATLogService(bool* isPending){
+    if (!didInit || streamOffset){return KVATException_invalidAccess;}
+
+    KVATException exception = KVATException_none;
+    bool didWork = false;
+
+    if (getErasedSectorCount()<LOGPOOLWATERMARK){
+        // One erase, or one clean, per call
+        exception = eraseStaleSector(&didWork);
+        if (exception==KVATException_none && !didWork){
+            exception = cleanSector(true, &didWork);
+        }
+    }
+
+    if (isPending!=NULL){
+        // More to do only if this call made progress
+        *isPending = exception==KVATException_none && didWork && getErasedSectorCount()<LOGPOOLWATERMARK;
+    }
+
+    return exception;
+}
+
+//////////////////////////////////////////////////////////////////
+
+KVATException KVATLogInit(){
+    if (didInit){return KVATException_invalidAccess;}
+
+    memset(table, 0, sizeof(table));
+    memset(sectorLive, 0, sizeof(sectorLive));
+    memset(sectorIsStale, 0, sizeof(sectorIsStale));
+    lastSequence = 0;
+
+    // Sectors in use, ordered by sequence (oldest first)
+    uint32_t order[LOGSECTORCOUNT];
+    uint32_t usedCount = 0;
+
+    for (uint32_t sector = 0; sector<LOGSECTORCOUNT; sector++){
+        const LogSectorHeader* header = FLASHMAP(LOGSTART+getSectorStart(sector));
+        sectorSequence[sector] = 0;
+        sectorWritten[sector] = 0;
+
+        if (header->magic==LOGSECTORMAGIC && header->sequence!=0 && header->sequence!=LOGERASED){
+            sectorSequence[sector] = header->sequence;
+            if (header->sequence>lastSequence){lastSequence = header->sequence;}
+
+            uint32_t orderI = usedCount++;
+            while (orderI>0 && sectorSequence[order[orderI-1]]>header->sequence){
+                order[orderI] = order[orderI-1];
+                orderI--;
+            }
+            order[orderI] = sector;
+        }else if (!isSectorErased(sector)){
+            // Interrupted erase, or something that isn't a log
+            if (!eraseSector(sector)){return KVATException_storageFault;}
+        }
+    }
+
+    // Find the written part of each sector, and the newest checkpoint
+    uint32_t replayOrderI = 0;
+    uint32_t replayOffset = usedCount ? getSectorStart(order[0])+sizeof(LogSectorHeader) : 0;
+
+    for (uint32_t orderI = 0; orderI<usedCount; orderI++){
+        uint32_t offset = getSectorStart(order[orderI])+sizeof(LogSectorHeader);
+        uint32_t size;
+
+        while ((size = checkRecord(offset))){
+            const LogRecordHeader* record = getRecord(offset);
+            if (record->commit==LOGCOMMIT && record->type==LOGRECORD_CHECKPOINT){
+                replayOrderI = orderI;
+                replayOffset = offset;
+            }
+            offset += size;
+        }
+
+        sectorWritten[order[orderI]] = offset-getSectorStart(order[orderI]);
+    }
+
+    // Rebuild the table from the checkpoint on (from the start if there is none)
+    recordsSinceCheckpoint = 0;
+    for (uint32_t orderI = replayOrderI; orderI<usedCount; orderI++){
+        uint32_t sectorStart = getSectorStart(order[orderI]);
+        uint32_t offset = orderI==replayOrderI ? replayOffset : sectorStart+sizeof(LogSectorHeader);
+
+        while (offset<sectorStart+sectorWritten[order[orderI]]){
+            if (getRecord(offset)->commit==LOGCOMMIT){
+                replayRecord(offset);
+                recordsSinceCheckpoint++;
+            }
+            offset += checkRecord(offset);
+        }
+    }
+
+    // Sectors left by a clean before the checkpoint (erase didn't happen)
+    for (uint32_t orderI = 0; orderI<replayOrderI; orderI++){
+        sectorIsStale[order[orderI]] = sectorLive[order[orderI]]==0;
+    }
+
+    // Keep appending into the newest sector
+    if (usedCount){
+        activeSector = order[usedCount-1];
+        writeOffset = getSectorStart(activeSector)+sectorWritten[activeSector];
+    }else{
+        activeSector = LOGSECTORCOUNT;
+    }
+
+    didInit = true;
+    return KVATException_none;
+}
@@ -0,0 +1,171 @@
+/*
+ * kvatlog.h
+ * KVAT - Key Value Address Table
+ * Log-structured store for internal flash (erase-before-write media)
+ *
+ * Records are appended in order into erased sectors and never overwritten in place.
+ * The table is kept in RAM, rebuilt at init from the last checkpoint and the records after it.
+ * Sectors with little live data are reclaimed by a cleaner (KVATLogClean), meant to be called when idle.
+ * Saves only take sectors that are already erased. KVATLogService erases in the background to keep
+ * the pool at its watermark, so saves pay program time but not erase time.
+ * Values are contiguous in flash, so they can be used in place (KVATLogRetrieveView).
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+#ifndef KVATLOG_H_
+#define KVATLOG_H_
+
+#include "kvat/kvat.h"
+
+// Prototypes ----------------------
+
+/**
+ * Initializes the log store. Erases the region if it doesn't hold a log, and rebuilds the table.
+ *
+ * @return KVATException_ (invalidAccess) (storageFault) (none)
+ */
+KVATException KVATLogInit();
+
+
+/**
+ * Saves data tagged with a key, as a new record at the end of the log. Saving the same value again writes nothing.
+ *
+ * @param      key            String tag for the value to save
+ * @param      value          Reference to value to save
+ * @param      valueSize      Length of the value to save
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (storageFault) (none)
+ *         insufficientSpace if the table is full, or the log is full and nothing can be cleaned.
+ */
+KVATException KVATLogSaveValue(const char* key, const void* value, KVATSize valueSize);
+
+
+/**
+ * Reads a value. Same modes as KVATRetrieveValue (buffer, or allocate when retrieveBuffer is NULL).
+ *
+ * @param      key                  String tag for the value to retrieve
+ * @param[out] retrieveBuffer       Reference to buffer to retrieve value into.
+ * @param      retrieveBufferSize   Size of retrieve buffer.
+ * @param[out] retrievePointerRef   Optional: Set to point to retrieved data. Set to NULL if no match found.
+ * @param[out] size                 Optional: Size of the value in bytes.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (heapError) (none)
+ */
+KVATException KVATLogRetrieveValue(const char* key, void* retrieveBuffer, KVATSize retrieveBufferSize, void** retrievePointerRef, KVATSize* size);
+
+
+/**
+ * Reads a value into a buffer, with a key of known length (and hash, if given). Never allocates.
+ *
+ * @param      key                  Key for the value to retrieve
+ * @param[out] retrieveBuffer       Reference to buffer to retrieve value into.
+ * @param      retrieveBufferSize   Size of retrieve buffer.
+ * @param[out] size                 Optional: Size of the value in bytes.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATLogRetrieveValueWithKey(const KVATKey* key, void* retrieveBuffer, KVATSize retrieveBufferSize, KVATSize* size);
+
+
+/**
+ * Gets a read-only pointer to a value in flash, with no copy and no allocation.
+ * The pointer is valid until the key is saved or deleted, or its sector is cleaned (KVATLogClean).
+ *
+ * @param      key            String tag for the value
+ * @param[out] view           Set to point to the value. NULL if not found.
+ * @param[out] size           Optional: Size of the value in bytes.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATLogRetrieveView(const char* key, const void** view, KVATSize* size);
+
+
+/**
+ * Gets a read-only pointer to a value in flash, with a key of known length (and hash, if given). Same as KVATLogRetrieveView.
+ *
+ * @param      key            Key for the value
+ * @param[out] view           Set to point to the value. NULL if not found.
+ * @param[out] size           Optional: Size of the value in bytes.
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (none)
+ */
+KVATException KVATLogRetrieveViewWithKey(const KVATKey* key, const void** view, KVATSize* size);
+
+
+/**
+ * Deletes a value (appends a delete record).
+ *
+ * @param      key            String tag of the value to delete
+ *
+ * @return KVATException_ (invalidAccess) (notFound) (insufficientSpace) (storageFault) (none)
+ */
+KVATException KVATLogDeleteValue(const char* key);
+
+
+/**
+ * Opens a stream to save a value a chunk at a time, into a single record. Chunks are programmed as they
+ * arrive. The record is committed on KVATLogWriteClose; until then, the previous value (if any) stays readable.
+ * Other log calls that write (save, delete, clean, service) fail with invalidAccess while the stream is open.
+ *
+ * @param      key            String tag for the value to save
+ * @param      expectedSize   Total size of the value that will be written through KVATLogWriteChunk
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (storageFault) (none)
+ */
+KVATException KVATLogWriteOpen(const char* key, KVATSize expectedSize);
+
+
+/**
+ * Appends a chunk of data to the open stream. On failure other than invalidAccess, the stream is discarded.
+ *
+ * @param      chunk          Reference to data to append
+ * @param      chunkSize      Size of the chunk. Total of all chunks must not exceed the expected size.
+ *
+ * @return KVATException_ (invalidAccess) (storageFault) (none)
+ */
+KVATException KVATLogWriteChunk(const void* chunk, KVATSize chunkSize);
+
+
+/**
+ * Completes the open stream and commits the record. Stream is closed in all cases.
+ *
+ * @return KVATException_ (invalidAccess) (storageFault) (none)
+ *         invalidAccess if the data written does not add up to the expected size (stream is discarded).
+ */
+KVATException KVATLogWriteClose();
+
+
+/**
+ * Discards the open stream. The previous value (if any) is kept.
+ *
+ * @return KVATException_ (invalidAccess) (none)
+ */
+KVATException KVATLogWriteAbort();
+
+
+/**
+ * Reclaims the sector with the lowest ratio of live data, if it is below the cleaning threshold
+ * (or if erased sectors are running out). Live records are moved to the end of the log, a checkpoint
+ * is written, and the sector is erased (with any other stale one). Call when idle to keep saves from cleaning inline.
+ *
+ * @param[out] didClean       Optional: Set to true if a sector was reclaimed.
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (storageFault) (none)
+ *         insufficientSpace if erased sectors are running out and no sector has dead records to reclaim.
+ */
+KVATException KVATLogClean(bool* didClean);
+
+
+/**
+ * Keeps the pool of erased sectors at its watermark (LOGPOOLWATERMARK): erases a stale (cleaned) sector,
+ * or cleans one if there are none. Does one erase or one clean per call, so it fits in a background task.
+ * If the pool runs down anyway, saves erase inline.
+ *
+ * @param[out] isPending      Optional: Set to true if the pool is still below the watermark and another call would help.
+ *
+ * @return KVATException_ (invalidAccess) (insufficientSpace) (storageFault) (none)
+ */
+KVATException KVATLogService(bool* isPending);
+
+#endif /* KVATLOG_H_ */
@@ -12,6 +12,7 @@
 #include <kvat/kvat.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "inc/hw_memmap.h"
 #include "driverlib/debug.h"
 #include "driverlib/gpio.h"
@@ -21,6 +22,9 @@
 #include "utils/uartstdio.h"
 #include "utils/ustdlib.h"
 #include "kvat/kvat.h"
+#include "kvat/kvat_frozen.h"
+#include "kvat/kvatlog.h"
+#include "kvat/kvat_move.h"
 
 #include "driverlib/rom.h"      // To use TivaWare contained in ROM
 #include "driverlib/rom_map.h"  //
@@ -33,6 +37,29 @@ void __error__(char *pcFilename, uint32_t ui32Line){
 }
 #endif
 
+// Single key frozen store (any seed places the only key). Larger stores are generated by tools/kvatfrozen.
+static const char frozenValue[] = "Frozen default";
+static const uint32_t frozenDisplacements[1] = {1};
+static const KVATFrozenEntry frozenEntries[1] = {{"frozenKey", frozenValue, sizeof(frozenValue)}};
+static const KVATFrozenStore frozenStore = {1, 1, frozenDisplacements, frozenEntries};
+
+// Tier on the log store: values over 64 bytes, or not used within 1000 reads and saves, are kept in flash
+static const KVATTier logTier = {&KVATLogWriteOpen, &KVATLogWriteChunk, &KVATLogWriteClose,
+                                 &KVATLogWriteAbort, &KVATLogRetrieveValue, &KVATLogDeleteValue, 64, 1000,
+                                 &KVATLogRetrieveView};
+static char tieredValue[100];
+
+// Backup kept in RAM, to import it back
+typedef struct BackupBuffer{
+    unsigned char data[1024];
+    KVATSize size;
+    KVATSize readOffset;
+}BackupBuffer;
+static BackupBuffer backup;
+static BackupBuffer restoredBackup;     // Export of the store after backup was imported
+
+#define CUTSTREAMCOUNT 130      // Streams cut by cutStreams. More than the entries of the table (PAGECOUNT).
+
 char testingMismatch[] = "*****\n     Expectation mismatch >>\n";
 /**
  * Provides logging capabilities by interpreting a KVATException.
@@ -68,6 +95,126 @@ bool test(char* title, bool expectingException, KVATException exception){
     return true;
 }
 
+/**
+ * Prints a key matched by a query.
+ *
+ * @param      key        Key matched
+ * @param      context    Unused
+ *
+ * @return true to keep the query going.
+ */
+bool printQueryMatch(const char* key, void* context){
+    UARTprintf("<f>%s\n     ", key);
+    return true;
+}
+
+/**
+ * Prints a change on a subscribed key.
+ *
+ * @param      key        Key changed
+ * @param      event      What happened to the key
+ * @param      size       Size of the value after the change
+ * @param      context    Unused
+ */
+void printChange(const char* key, KVATEvent event, KVATSize size, void* context){
+    UARTprintf("<changed>%s <event>%d <size>%d\n     ", key, event, size);
+}
+
+/**
+ * Prints a change listed by the change log.
+ *
+ * @param      key        Key changed
+ * @param      event      Save or delete
+ * @param      sequence   Sequence of the change
+ * @param      context    Unused
+ *
+ * @return true to keep listing.
+ */
+bool printLoggedChange(const char* key, KVATEvent event, KVATSequence sequence, void* context){
+    UARTprintf("<changed>%s <event>%d <seq>%d\n     ", key, event, sequence);
+    return true;
+}
+
+/**
+ * Prints the bytes of a backup as hex.
+ *
+ * @param      data       Bytes of the backup
+ * @param      size       Number of bytes
+ * @param      context    Unused
+ *
+ * @return true (printing doesn't fail).
+ */
+bool printBackupBytes(const void* data, KVATSize size, void* context){
+    for (KVATSize byteI = 0; byteI<size; byteI++){
+        UARTprintf("%02x", ((const unsigned char*)data)[byteI]);
+    }
+    return true;
+}
+
+/**
+ * Keeps the bytes of a backup in a BackupBuffer.
+ *
+ * @param      data       Bytes of the backup
+ * @param      size       Number of bytes
+ * @param      context    BackupBuffer to add to
+ *
+ * @return false if the backup doesn't fit.
+ */
+bool keepBackupBytes(const void* data, KVATSize size, void* context){
+    BackupBuffer* buffer = context;
+    if (buffer->size+size>sizeof(buffer->data)){return false;}
+
+    memcpy(buffer->data+buffer->size, data, size);
+    buffer->size += size;
+    return true;
+}
+
+/**
+ * Reads the bytes of a backup kept in a BackupBuffer.
+ *
+ * @param      data       Buffer for the bytes read
+ * @param      size       Number of bytes
+ * @param      context    BackupBuffer to read from
+ *
+ * @return false past the end of the backup.
+ */
+bool readBackupBytes(void* data, KVATSize size, void* context){
+    BackupBuffer* buffer = context;
+    if (buffer->readOffset+size>buffer->size){return false;}
+
+    memcpy(data, buffer->data+buffer->readOffset, size);
+    buffer->readOffset += size;
+    return true;
+}
+
+/**
+ * Compares two backups byte by byte. A store exported, imported and exported again gives the same backup.
+ *
+ * @return KVATException_ (invalidFormat) (none)
+ *         invalidFormat if the backups differ.
+ */
+KVATException compareBackups(const BackupBuffer* first, const BackupBuffer* second){
+    if (first->size!=second->size || memcmp(first->data, second->data, first->size)!=0){return KVATException_invalidFormat;}
+    return KVATException_none;
+}
+
+/**
+ * Opens a stream on a new key and stops the store before it is closed, as a reset would, then starts it again.
+ * Repeated more times than the table has entries, so a leaked entry would run the table out.
+ *
+ * @return KVATException_ of the first step that failed, or none.
+ */
+KVATException cutStreams(){
+    for (KVATSize cutI = 0; cutI<CUTSTREAMCOUNT; cutI++){
+        KVATException exception = KVATWriteOpen("cutStream", 40);
+        if (exception==KVATException_none){exception = KVATWriteChunk("Cut short by a reset", 20);}
+        if (exception==KVATException_none){exception = KVATDeinit();}
+        if (exception==KVATException_none){exception = KVATInit();}
+        if (exception!=KVATException_none){return exception;}
+    }
+    return KVATException_none;
+}
+
 /**
  * Performs a series of tests on KVAT to check for correct operation.
  */
@@ -154,6 +301,256 @@ void kvatTest(){
     }
 
 
+    // Streaming write in chunks
+    test("Open streaming write", false, KVATWriteOpen("streamed", 30));
+    test("Write first chunk", false, KVATWriteChunk("Streamed in ", 12));
+    test("Write second chunk", false, KVATWriteChunk("multiple chunks.", 17));
+    test("Close incomplete stream, should fail", true, KVATWriteClose());
+
+    test("Open streaming write again", false, KVATWriteOpen("streamed", 29));
+    test("Write first chunk", false, KVATWriteChunk("Streamed in ", 12));
+    test("Write second chunk", false, KVATWriteChunk("multiple chunks.", 17));
+    test("Close stream", false, KVATWriteClose());
+
+    // Retrieve streamed value
+    if (test("Retrieve streamed string", false, KVATRetrieveStringByAllocation("streamed", &ret))){
+        UARTprintf("<v>%s\n", (char*)ret);
+
+        free(ret);
+    }
+
+    // Streaming write cut by a reset: the entry and pages it took are free again on init
+    KVATSize keysBeforeCut = 0;
+    KVATSize keysAfterCut = 0;
+    test("Count keys before cut streams", false, KVATCount(&keysBeforeCut));
+    test("Reset during streaming write, repeatedly", false, cutStreams());
+    if (test("Count keys after cut streams", false, KVATCount(&keysAfterCut))){
+        UARTprintf("<count>%d (before %d)\n", keysAfterCut, keysBeforeCut);
+    }
+    test("Cut stream left no key, should fail", true, KVATExists("cutStream"));
+    test("Save after cut streams", false, KVATSaveString("afterCut", "Entry found."));
+    test("Delete after cut streams", false, KVATDeleteValue("afterCut"));
+
+
+    // Save only on change
+    bool didSave;
+    test("Save same string if changed", false, KVATSaveIfChanged("streamed", "Streamed in multiple chunks.", 29, &didSave));
+    UARTprintf("<saved>%d\n", didSave);
+
+    // Compare and save
+    test("Compare and save with wrong expectation, should fail", true, KVATCompareAndSave("singKey", "First.", 7, "Swapped.", 9));
+    test("Compare and save", false, KVATCompareAndSave("streamed", "Streamed in multiple chunks.", 29, "Swapped.", 9));
+
+
+    // Counters
+    KVATCounter count;
+    KVATCounterHandle counterHandle;
+    test("Add to counter", false, KVATCounterAdd("bootCount", 1, &count));
+    test("Open counter handle", false, KVATCounterOpen("bootCount", &counterHandle));
+    if (test("Add to counter through handle", false, KVATCounterAddByHandle(&counterHandle, 1, &count))){
+        UARTprintf("<c>%d\n", count);
+    }
+    test("Add to counter on string key, should fail", true, KVATCounterAdd("singKey", 1, &count));
+
+
+    // Metadata queries
+    KVATSize valueSize;
+    KVATFlags valueFlags;
+    test("Check if key exists", false, KVATExists("singKey"));
+    test("Check if deleted key exists, should fail", true, KVATExists("secondstuff"));
+    if (test("Stat value", false, KVATStat("singKey", &valueSize, &valueFlags))){
+        UARTprintf("<size>%d <flags>%d\n", valueSize, valueFlags);
+    }
+
+
+    // Key counts
+    KVATSize keyCount;
+    if (test("Count keys", false, KVATCount(&keyCount))){
+        UARTprintf("<count>%d\n", keyCount);
+    }
+    test("Register prefix counter", false, KVATRegisterPrefixCounter("route/"));
+    if (test("Count keys with prefix", false, KVATCountPrefix("route/", &keyCount))){
+        UARTprintf("<count>%d\n", keyCount);
+    }
+    test("Count keys with unregistered prefix, should fail", true, KVATCountPrefix("user/", &keyCount));
+
+
+    // Bulk delete
+    test("Save string in profile", false, KVATSaveString("user3/name", "repixen"));
+    test("Save another string in profile", false, KVATSaveString("user3/lang", "C"));
+    if (test("Delete profile by prefix", false, KVATDeletePrefix("user3/", &keyCount))){
+        UARTprintf("<deleted>%d\n", keyCount);
+    }
+    test("Retrieve deleted profile string, should fail", true, KVATRetrieveStringByBuffer("user3/name", searchResults, 32));
+
+
+    // Batched search
+    char manyResults[64];
+    id = INITIALID;
+    if (test("Looking for many keys (s)", false, KVATSearchMany("s", &id, manyResults, 64, NULL, 8, &keyCount))){
+        char* result = manyResults;
+        for (KVATSize resultI = 0; resultI<keyCount; resultI++){
+            UARTprintf("<f>%s\n     ", result);
+            result += ustrlen(result)+1;
+        }
+    }
+
+
+    // Pattern query
+    if (test("Query keys (route/**/this.h)", false, KVATQuery("route/**/this.h", &printQueryMatch, NULL, &keyCount))){
+        UARTprintf("<matched>%d\n", keyCount);
+    }
+
+
+    // Change subscriptions
+    KVATSubscriptionID subscriptionID;
+    test("Subscribe to prefix (route/)", false, KVATSubscribe("route/", true, &printChange, NULL, &subscriptionID));
+    test("Save string with subscribed route", false, KVATSaveString("route/key/other.h", "Change is notified"));
+    test("Delete string with subscribed route", false, KVATDeleteValue("route/key/other.h"));
+    test("Unsubscribe", false, KVATUnsubscribe(subscriptionID));
+    test("Unsubscribe again, should fail", true, KVATUnsubscribe(subscriptionID));
+
+
+    // Change log
+    KVATSequence sequence;
+    test("List all changes", false, KVATChangesSince(0, &printLoggedChange, NULL, &sequence));
+    test("Delete string", false, KVATDeleteValue("singKey"));
+    test("List changes since last listing", false, KVATChangesSince(sequence, &printLoggedChange, NULL, &sequence));
+
+
+    // Backup
+    if (test("Export store", false, KVATExport(&printBackupBytes, NULL, &keyCount))){
+        UARTprintf("\n     <exported>%d\n", keyCount);
+    }
+    test("Export store to RAM", false, KVATExport(&keepBackupBytes, &backup, NULL));
+    test("Import into store with keys, should fail", true, KVATImport(&readBackupBytes, &backup, NULL));
+
+
+    // Frozen store
+    test("Set frozen store", false, KVATSetFrozenStore(&frozenStore));
+    if (test("Retrieve frozen string", false, KVATRetrieveStringByBuffer("frozenKey", searchResults, 32))){
+        UARTprintf("<v>%s\n", searchResults);
+    }
+    const void* view;
+    if (test("View frozen string in place", false, KVATRetrieveView("frozenKey", &view, &valueSize))){
+        UARTprintf("<v>%s <size>%d\n", (const char*)view, valueSize);
+    }
+    test("Override frozen string", false, KVATSaveString("frozenKey", "Saved over"));
+    test("View string in EEPROM, should fail", true, KVATRetrieveView("frozenKey", &view, &valueSize));
+    test("Delete override", false, KVATDeleteValue("frozenKey"));
+    test("Check frozen key exists again", false, KVATExists("frozenKey"));
+
+
+    // Storage backend
+    test("Set backend after init, should fail", true, KVATSetBackend(NULL));
+
+
+    // Log store (internal flash)
+    test("Init log store", false, KVATLogInit());
+    test("Save string in log", false, KVATLogSaveValue("logKey", "Appended to flash", 18));
+    if (test("Retrieve string from log", false, KVATLogRetrieveValue("logKey", searchResults, 32, NULL, &valueSize))){
+        UARTprintf("<v>%s <size>%d\n", searchResults, valueSize);
+    }
+    test("View string in log", false, KVATLogRetrieveView("logKey", &view, NULL));
+    test("Delete string from log", false, KVATLogDeleteValue("logKey"));
+    test("Retrieve deleted string from log, should fail", true, KVATLogRetrieveValue("logKey", searchResults, 32, NULL, NULL));
+    test("Save string to move", false, KVATSaveString("moveKey", "Moves between stores"));
+    test("Move string to log", false, KVATMove(KVATStore_eeprom, KVATStore_log, "moveKey"));
+    test("Check moved string left EEPROM, should fail", true, KVATExists("moveKey"));
+    test("Move string back to EEPROM", false, KVATMove(KVATStore_log, KVATStore_eeprom, "moveKey"));
+    test("Copy string to log", false, KVATCopy(KVATStore_eeprom, KVATStore_log, "moveKey"));
+    test("Move within a store, should fail", true, KVATMove(KVATStore_log, KVATStore_log, "moveKey"));
+    test("Clean log", false, KVATLogClean(NULL));
+    test("Service log erase pool", false, KVATLogService(NULL));
+
+
+    // Tiering
+    test("Set tier", false, KVATSetTier(&logTier));
+    for (KVATSize byteI = 0; byteI<sizeof(tieredValue)-1; byteI++){
+        tieredValue[byteI] = '*';
+    }
+    test("Save large string", false, KVATSaveString("tierKey", tieredValue));
+    if (test("Stat large string", false, KVATStat("tierKey", &valueSize, &valueFlags))){
+        UARTprintf("<size>%d <tiered>%d\n", valueSize, (valueFlags & KVATFLAG_TIERED)!=0);
+    }
+    test("Retrieve large string from tier", false, KVATRetrieveValue("tierKey", tieredValue, sizeof(tieredValue), NULL, NULL));
+    test("Rename tiered key, should fail", true, KVATChangeKey("tierKey", "tierKey2"));
+    test("Save string in log under tiered key", false, KVATLogSaveValue("tierKey", "Log's own", 10));
+    test("Delete string from log under tiered key", false, KVATLogDeleteValue("tierKey"));
+    test("Retrieve large string from tier after log delete", false, KVATRetrieveValue("tierKey", tieredValue, sizeof(tieredValue), NULL, NULL));
+    test("Move large string to log", false, KVATMove(KVATStore_eeprom, KVATStore_log, "tierKey"));
+    test("Retrieve moved large string from log", false, KVATLogRetrieveValue("tierKey", tieredValue, sizeof(tieredValue), NULL, NULL));
+    test("Move large string back to EEPROM", false, KVATMove(KVATStore_log, KVATStore_eeprom, "tierKey"));
+    if (test("Move cold values to tier", false, KVATTierService(&keyCount))){
+        UARTprintf("<moved>%d\n", keyCount);
+    }
+
+    // Backup round trip: every value, counters and tiered values included, comes back
+    KVATCounter backupCount;
+    test("Add to counter before backup", false, KVATCounterAdd("backupCount", 7, &backupCount));
+    test("Save large string in tier before backup", false, KVATSaveString("tierKey", tieredValue));
+    backup.size = 0;
+    backup.readOffset = 0;
+    if (test("Export store with tiered string", false, KVATExport(&keepBackupBytes, &backup, &keyCount))){
+        UARTprintf("<exported>%d <bytes>%d\n", keyCount, backup.size);
+    }
+    test("Clear store before import", false, KVATDeletePrefix("", NULL));
+    if (test("Import backup", false, KVATImport(&readBackupBytes, &backup, &keyCount))){
+        UARTprintf("<imported>%d\n", keyCount);
+    }
+    restoredBackup.size = 0;
+    test("Export imported store", false, KVATExport(&keepBackupBytes, &restoredBackup, NULL));
+    test("Compare backups before and after import", false, compareBackups(&backup, &restoredBackup));
+    if (test("Get counter after import", false, KVATCounterGet("backupCount", &backupCount))){
+        UARTprintf("<count>%d\n", backupCount);
+    }
+    if (test("Stat large string after import", false, KVATStat("tierKey", &valueSize, &valueFlags))){
+        UARTprintf("<size>%d <tiered>%d\n", valueSize, (valueFlags & KVATFLAG_TIERED)!=0);
+    }
+    test("Retrieve large string after import", false, KVATRetrieveValue("tierKey", tieredValue, sizeof(tieredValue), NULL, NULL));
+    UARTprintf("<v>%s\n", tieredValue);
+    test("Delete counter after import", false, KVATDeleteValue("backupCount"));
+
+    test("Delete large string", false, KVATDeleteValue("tierKey"));
+    test("Stop tiering", false, KVATSetTier(NULL));
+
+
+    // Cache (evictable values)
+    test("Save evictable string", false, KVATSaveEvictable("cacheKey", "Downloaded, can go", 19));
+    if (test("Stat evictable string", false, KVATStat("cacheKey", &valueSize, &valueFlags))){
+        UARTprintf("<size>%d <evictable>%d\n", valueSize, (valueFlags & KVATFLAG_EVICTABLE)!=0);
+    }
+    test("Make evictable string permanent", false, KVATSaveString("cacheKey", "Kept for good"));
+    test("Delete cached string", false, KVATDeleteValue("cacheKey"));
+
+
+    // Resize
+    test("Save string before resize", false, KVATSaveString("resizeKey", "Kept through resizes"));
+    test("Grow store", false, KVATResize(160));
+    test("Retrieve string after growing", false, KVATRetrieveStringByBuffer("resizeKey", searchResults, 32));
+    test("Shrink store back", false, KVATResize(128));
+    test("Retrieve string after shrinking", false, KVATRetrieveStringByBuffer("resizeKey", searchResults, 32));
+    test("Resize to a single page, should fail", true, KVATResize(1));
+    test("Delete resize string", false, KVATDeleteValue("resizeKey"));
+
+
+    // Keys of known length
+    const KVATKey sizedKey = {"sizedKey", 8};
+    const KVATKey shorterKey = {"sized", 5};
+    test("Save string with sized key", false, KVATSaveValueWithKey(&sizedKey, "Matched by length", 18));
+    test("Retrieve string with sized key", false, KVATRetrieveValueWithKey(&sizedKey, searchResults, 32, &valueSize));
+    test("Stat sized key by string", false, KVATStat("sizedKey", NULL, NULL));
+    test("Stat shorter sized key, should fail", true, KVATStatWithKey(&shorterKey, NULL, NULL));
+    test("Delete string with sized key", false, KVATDeleteValueWithKey(&sizedKey));
+
+    // Hashed keys (as generated by tools/kvatkeys)
+    const KVATKey hashedKey = {"hashedKey", 9, kvatFrozenHash("hashedKey", 0)};
+    test("Save string in log", false, KVATLogSaveValue("hashedKey", "Found by hash", 14));
+    test("View string in log with hashed key", false, KVATLogRetrieveViewWithKey(&hashedKey, &view, NULL));
+    test("Delete string from log", false, KVATLogDeleteValue("hashedKey"));
+    test("Retrieve missing value with hashed key, should fail", true, KVATRetrieveValueWithKey(&hashedKey, searchResults, 32, NULL));
+
+
     UARTprintf("\nFinished testing\n============\n");
 
 
@@ -0,0 +1,23 @@
+/*
+ * eeprom.h
+ * KVAT host shim - stands in for the TivaWare header when building tools for the host.
+ * Storage is a RAM buffer. See eeprom_host.h.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <stdint.h>
+
+#define EEPROM_INIT_OK      0
+#define EEPROM_INIT_ERROR   2
+
+uint32_t EEPROMInit(void);
+uint32_t EEPROMSizeGet(void);
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+
+#endif /* HOST_EEPROM_H_ */
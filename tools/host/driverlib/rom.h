@@ -0,0 +1,12 @@
+/*
+ * rom.h
+ * KVAT host shim - there is no ROM on the host. Everything maps to the shim functions (see rom_map.h).
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef HOST_ROM_H_
+#define HOST_ROM_H_
+
+#endif /* HOST_ROM_H_ */
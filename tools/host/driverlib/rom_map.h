@@ -0,0 +1,19 @@
+/*
+ * rom_map.h
+ * KVAT host shim - maps the MAP_ calls used by KVAT to the shim functions.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef HOST_ROM_MAP_H_
+#define HOST_ROM_MAP_H_
+
+#define MAP_SysCtlPeripheralEnable  SysCtlPeripheralEnable
+#define MAP_SysCtlPeripheralReady   SysCtlPeripheralReady
+#define MAP_EEPROMInit              EEPROMInit
+#define MAP_EEPROMSizeGet           EEPROMSizeGet
+#define MAP_EEPROMRead              EEPROMRead
+#define MAP_EEPROMProgram           EEPROMProgram
+
+#endif /* HOST_ROM_MAP_H_ */
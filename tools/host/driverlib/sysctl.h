@@ -0,0 +1,20 @@
+/*
+ * sysctl.h
+ * KVAT host shim - stands in for the TivaWare header when building tools for the host.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef HOST_SYSCTL_H_
+#define HOST_SYSCTL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SYSCTL_PERIPH_EEPROM0   0xf0005800  // EEPROM 0 (same value as TivaWare)
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral);
+
+#endif /* HOST_SYSCTL_H_ */
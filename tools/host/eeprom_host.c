@@ -0,0 +1,56 @@
+/*
+ * eeprom_host.c
+ * KVAT host shim - RAM-backed EEPROM for host tools.
+ * Mirrors the TivaWare calls used by KVAT. Addresses and counts must be word aligned, as on the device.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "eeprom_host.h"
+
+#include <string.h>
+#include "driverlib/sysctl.h"
+#include "driverlib/eeprom.h"
+
+uint8_t hostEEPROM[HOSTEEPROMSIZE];
+
+static int isErased = 0;
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral){
+}
+
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral){
+    return true;
+}
+
+uint32_t EEPROMInit(void){
+    // Fresh parts come erased
+    if (!isErased){
+        memset(hostEEPROM, 0xFF, HOSTEEPROMSIZE);
+        isErased = 1;
+    }
+    return EEPROM_INIT_OK;
+}
+
+uint32_t EEPROMSizeGet(void){
+    return HOSTEEPROMSIZE;
+}
+
+/**
+ * Checks that an access is word aligned and within the EEPROM.
+ */
+static int isValidAccess(uint32_t ui32Address, uint32_t ui32Count){
+    return ui32Address%4==0 && ui32Count%4==0 && ui32Address+ui32Count<=HOSTEEPROMSIZE;
+}
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count){
+    if (!isValidAccess(ui32Address, ui32Count)){return;}
+    memcpy(pui32Data, hostEEPROM+ui32Address, ui32Count);
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count){
+    if (!isValidAccess(ui32Address, ui32Count)){return 1;}
+    memcpy(hostEEPROM+ui32Address, pui32Data, ui32Count);
+    return 0;
+}
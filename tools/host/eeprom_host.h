@@ -0,0 +1,18 @@
+/*
+ * eeprom_host.h
+ * KVAT host shim - RAM-backed EEPROM for host tools.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef EEPROM_HOST_H_
+#define EEPROM_HOST_H_
+
+#include <stdint.h>
+
+#define HOSTEEPROMSIZE 6144     // Size of the EEPROM on TM4C129 devices (bytes)
+
+extern uint8_t hostEEPROM[HOSTEEPROMSIZE];    // Contents of the simulated EEPROM. Starts erased (0xFF).
+
+#endif /* EEPROM_HOST_H_ */
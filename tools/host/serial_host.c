@@ -0,0 +1,82 @@
+/*
+ * serial_host.c
+ * KVAT host shim - simulated serial memory (25-series SPI FRAM or serial EEPROM) for host tools.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "serial_host.h"
+
+#include <string.h>
+
+#define WRITECYCLEPOLLS 3   // Status polls a serial EEPROM stays busy after a write
+
+uint8_t hostSerial[HOSTSERIALSIZE];
+uint32_t hostSerialWritePageSize = 0;
+uint32_t hostSerialTransactions = 0;
+uint32_t hostSerialBusBytes = 0;
+
+static bool isErased = false;
+static bool isWriteEnabled = false;
+static uint32_t busyPolls = 0;
+
+bool hostSerialTransfer(const uint8_t* command, uint32_t commandSize, const void* txData, void* rxData, uint32_t dataSize, void* context){
+    // Fresh parts come erased
+    if (!isErased){
+        memset(hostSerial, 0xFF, HOSTSERIALSIZE);
+        isErased = true;
+    }
+
+    hostSerialTransactions++;
+    hostSerialBusBytes += commandSize+dataSize;
+
+    if (commandSize==0){return false;}
+
+    // Status can be read during a write cycle
+    if (command[0]==0x05){
+        if (rxData==NULL || dataSize==0){return false;}
+        memset(rxData, (busyPolls ? 0x01 : 0x00) | (isWriteEnabled ? 0x02 : 0x00), dataSize);
+        if (busyPolls){busyPolls--;}
+        return true;
+    }
+
+    // Anything else is ignored while busy (reads return the bus pulled up)
+    if (busyPolls){
+        if (rxData!=NULL){memset(rxData, 0xFF, dataSize);}
+        return true;
+    }
+
+    if (command[0]==0x06){
+        isWriteEnabled = true;
+        return true;
+    }
+
+    if (commandSize!=3){return false;}
+    uint32_t address = ((uint32_t)command[1]<<8 | command[2]) % HOSTSERIALSIZE;
+
+    if (command[0]==0x03 && rxData!=NULL){
+        // Sequential read wraps around the memory
+        for (uint32_t byteI = 0; byteI<dataSize; byteI++){
+            ((uint8_t*)rxData)[byteI] = hostSerial[(address+byteI) % HOSTSERIALSIZE];
+        }
+        return true;
+    }
+
+    if (command[0]==0x02 && txData!=NULL){
+        if (!isWriteEnabled){return true;}
+
+        // Serial EEPROM wraps within the write page, FRAM around the memory
+        uint32_t pageStart = hostSerialWritePageSize ? address - address%hostSerialWritePageSize : 0;
+        uint32_t pageSize = hostSerialWritePageSize ? hostSerialWritePageSize : HOSTSERIALSIZE;
+        for (uint32_t byteI = 0; byteI<dataSize; byteI++){
+            hostSerial[pageStart + (address-pageStart+byteI) % pageSize] = ((const uint8_t*)txData)[byteI];
+        }
+
+        isWriteEnabled = false;
+        if (hostSerialWritePageSize){busyPolls = WRITECYCLEPOLLS;}
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,29 @@
+/*
+ * serial_host.h
+ * KVAT host shim - simulated serial memory (25-series SPI FRAM or serial EEPROM) for host tools.
+ * Its transfer function is a KVATSerialTransfer, to use with kvat_serial.h.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef SERIAL_HOST_H_
+#define SERIAL_HOST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define HOSTSERIALSIZE 32768    // Size of the simulated memory (bytes). Addressed with 2 bytes.
+
+extern uint8_t hostSerial[HOSTSERIALSIZE];  // Contents of the simulated memory. Starts erased (0xFF).
+extern uint32_t hostSerialWritePageSize;    // Write page in bytes (serial EEPROM). 0 for FRAM. Set before use.
+extern uint32_t hostSerialTransactions;     // Transactions so far
+extern uint32_t hostSerialBusBytes;         // Bytes on the bus so far (command and data)
+
+/**
+ * Carries out a transaction on the simulated memory. Behaves as the device would: writes need a
+ * write enable, wrap within a write page, and keep a serial EEPROM busy for a few status polls.
+ */
+bool hostSerialTransfer(const uint8_t* command, uint32_t commandSize, const void* txData, void* rxData, uint32_t dataSize, void* context);
+
+#endif /* SERIAL_HOST_H_ */
@@ -0,0 +1,265 @@
+/*
+ * kvatfrozen.c
+ * KVAT - Key Value Address Table
+ *
+ * Host tool that generates a frozen store: a C source with const keys, values and a minimal perfect
+ * hash over the keys (see kvat_frozen.h). Compiled into the firmware, it stays in flash and is set
+ * with KVATSetFrozenStore as fallback for keys that are not in EEPROM.
+ *
+ * Usage: kvatfrozen <manifest> <output.c> [name]
+ * Manifest format: see manifest.h (counters are not supported, frozen values are read-only).
+ * The store is named kvatFrozenDefaults unless a name is given. Declare it where it is used:
+ *     extern const KVATFrozenStore kvatFrozenDefaults;
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat_frozen.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "manifest.h"
+
+#define BUCKETLOAD 4            // Average keys per bucket. Larger takes longer to generate, but keeps fewer displacements.
+#define DISPLACEMENTTRIES 0x1000000 // Seeds tried per bucket before giving up
+
+// Key and value read from the manifest
+typedef struct FrozenKey{
+    char* key;
+    unsigned char* value;
+    KVATSize valueSize;
+    uint32_t bucket;
+}FrozenKey;
+
+static FrozenKey* keys = NULL;
+static uint32_t keyCount = 0;
+
+/**
+ * Reads every key of the manifest into keys.
+ *
+ * @return true on success.
+ */
+static bool readManifest(FILE* manifest){
+    char line[LINEMAXLEN];
+    unsigned lineNumber = 0;
+    uint32_t keyCapacity = 0;
+
+    while (fgets(line, LINEMAXLEN, manifest)){
+        lineNumber++;
+        if (strchr(line, '\n')==NULL && !feof(manifest)){
+            fprintf(stderr, "line %u: too long\n", lineNumber);
+            return false;
+        }
+
+        ManifestLine parsed;
+        if (!parseManifestLine(line, lineNumber, &parsed)){return false;}
+        if (parsed.type==ManifestType_none){continue;}
+        if (parsed.type==ManifestType_counter){
+            fprintf(stderr, "line %u: counters can't be frozen\n", lineNumber);
+            return false;
+        }
+
+        for (uint32_t keyI = 0; keyI<keyCount; keyI++){
+            if (strcmp(keys[keyI].key, parsed.key)==0){
+                fprintf(stderr, "line %u: duplicate key\n", lineNumber);
+                return false;
+            }
+        }
+
+        if (keyCount==keyCapacity){
+            keyCapacity = keyCapacity ? keyCapacity*2 : 32;
+            FrozenKey* grown = realloc(keys, sizeof(FrozenKey)*keyCapacity);
+            if (grown==NULL){return false;}
+            keys = grown;
+        }
+
+        FrozenKey* key = &keys[keyCount];
+        key->key = malloc(strlen(parsed.key)+1);
+        key->value = malloc(parsed.size);
+        if (key->key==NULL || key->value==NULL){return false;}
+        strcpy(key->key, parsed.key);
+        memcpy(key->value, parsed.value, parsed.size);
+        key->valueSize = parsed.size;
+        keyCount++;
+    }
+
+    return true;
+}
+
+/**
+ * Builds the perfect hash (hash and displace). Buckets are placed largest first, each with the first
+ * seed that sends all its keys to free, distinct entries.
+ *
+ * @param      bucketCount     Number of buckets.
+ * @param[out] displacements   Seed per bucket.
+ * @param[out] slots           Key placed in each entry.
+ *
+ * @return true on success.
+ */
+static bool buildHash(uint32_t bucketCount, uint32_t* displacements, uint32_t* slots){
+    uint32_t* bucketSizes = calloc(bucketCount, sizeof(uint32_t));
+    uint32_t* bucketOrder = malloc(sizeof(uint32_t)*bucketCount);
+    bool* isTaken = calloc(keyCount, sizeof(bool));
+    uint32_t* trySlots = malloc(sizeof(uint32_t)*keyCount);
+    bool didBuild = bucketSizes && bucketOrder && isTaken && trySlots;
+
+    if (didBuild){
+        for (uint32_t keyI = 0; keyI<keyCount; keyI++){
+            keys[keyI].bucket = kvatFrozenHash(keys[keyI].key, 0) % bucketCount;
+            bucketSizes[keys[keyI].bucket]++;
+        }
+
+        // Largest buckets first (insertion sort, bucket count is small)
+        for (uint32_t bucketI = 0; bucketI<bucketCount; bucketI++){
+            uint32_t orderI = bucketI;
+            while (orderI>0 && bucketSizes[bucketOrder[orderI-1]]<bucketSizes[bucketI]){
+                bucketOrder[orderI] = bucketOrder[orderI-1];
+                orderI--;
+            }
+            bucketOrder[orderI] = bucketI;
+        }
+    }
+
+    for (uint32_t orderI = 0; didBuild && orderI<bucketCount; orderI++){
+        uint32_t bucket = bucketOrder[orderI];
+        displacements[bucket] = 0;
+        if (bucketSizes[bucket]==0){continue;}
+
+        bool isPlaced = false;
+        for (uint32_t seed = 1; seed<DISPLACEMENTTRIES && !isPlaced; seed++){
+            uint32_t tryCount = 0;
+            isPlaced = true;
+
+            for (uint32_t keyI = 0; keyI<keyCount && isPlaced; keyI++){
+                if (keys[keyI].bucket!=bucket){continue;}
+
+                uint32_t slot = kvatFrozenHash(keys[keyI].key, seed) % keyCount;
+                isPlaced = !isTaken[slot];
+                for (uint32_t tryI = 0; tryI<tryCount && isPlaced; tryI++){
+                    isPlaced = trySlots[tryI]!=slot;
+                }
+                trySlots[tryCount++] = slot;
+            }
+
+            if (isPlaced){
+                displacements[bucket] = seed;
+                tryCount = 0;
+                for (uint32_t keyI = 0; keyI<keyCount; keyI++){
+                    if (keys[keyI].bucket!=bucket){continue;}
+                    uint32_t slot = trySlots[tryCount++];
+                    isTaken[slot] = true;
+                    slots[slot] = keyI;
+                }
+            }
+        }
+
+        didBuild = isPlaced;
+    }
+
+    free(bucketSizes);
+    free(bucketOrder);
+    free(isTaken);
+    free(trySlots);
+
+    return didBuild;
+}
+
+/**
+ * Writes a string as a C literal.
+ */
+static void writeStringLiteral(FILE* output, const char* text){
+    fputc('"', output);
+    for (; *text; text++){
+        unsigned char c = *text;
+        if (c=='"' || c=='\\'){
+            fprintf(output, "\\%c", c);
+        }else if (c<0x20 || c>=0x7F){
+            fprintf(output, "\\%03o", c);
+        }else{
+            fputc(c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+/**
+ * Writes the frozen store as C source.
+ */
+static void writeStore(FILE* output, const char* manifestName, const char* name, uint32_t bucketCount, const uint32_t* displacements, const uint32_t* slots){
+    fprintf(output, "/*\n * Frozen store generated by kvatfrozen from %s. Do not edit.\n */\n\n", manifestName);
+    fprintf(output, "#include \"kvat/kvat_frozen.h\"\n\n");
+
+    if (keyCount==0){
+        fprintf(output, "const KVATFrozenStore %s = {0, 0, NULL, NULL};\n", name);
+        return;
+    }
+
+    for (uint32_t slot = 0; slot<keyCount; slot++){
+        FrozenKey* key = &keys[slots[slot]];
+        fprintf(output, "static const unsigned char value%u[] = {", slot);
+        for (KVATSize byteI = 0; byteI<key->valueSize; byteI++){
+            fprintf(output, "%s0x%02X", byteI ? ", " : "", key->value[byteI]);
+        }
+        fprintf(output, "};\n");
+    }
+
+    fprintf(output, "\nstatic const uint32_t displacements[%u] = {", bucketCount);
+    for (uint32_t bucket = 0; bucket<bucketCount; bucket++){
+        fprintf(output, "%s%u", bucket ? ", " : "", displacements[bucket]);
+    }
+    fprintf(output, "};\n\n");
+
+    fprintf(output, "static const KVATFrozenEntry entries[%u] = {\n", keyCount);
+    for (uint32_t slot = 0; slot<keyCount; slot++){
+        FrozenKey* key = &keys[slots[slot]];
+        fprintf(output, "    {");
+        writeStringLiteral(output, key->key);
+        fprintf(output, ", value%u, %u},\n", slot, (unsigned)key->valueSize);
+    }
+    fprintf(output, "};\n\n");
+
+    fprintf(output, "const KVATFrozenStore %s = {%u, %u, displacements, entries};\n", name, keyCount, bucketCount);
+}
+
+int main(int argc, char** argv){
+    if (argc!=3 && argc!=4){
+        fprintf(stderr, "usage: %s <manifest> <output.c> [name]\n", argv[0]);
+        return 2;
+    }
+    const char* name = argc==4 ? argv[3] : "kvatFrozenDefaults";
+
+    FILE* manifest = fopen(argv[1], "r");
+    if (manifest==NULL){
+        perror(argv[1]);
+        return 1;
+    }
+    bool didRead = readManifest(manifest);
+    fclose(manifest);
+    if (!didRead){return 1;}
+
+    uint32_t bucketCount = keyCount/BUCKETLOAD+1;
+    uint32_t* displacements = calloc(bucketCount, sizeof(uint32_t));
+    uint32_t* slots = malloc(sizeof(uint32_t)*(keyCount ? keyCount : 1));
+    if (displacements==NULL || slots==NULL){return 1;}
+
+    if (keyCount && !buildHash(bucketCount, displacements, slots)){
+        fprintf(stderr, "could not build perfect hash\n");
+        return 1;
+    }
+
+    FILE* output = fopen(argv[2], "w");
+    if (output==NULL){
+        perror(argv[2]);
+        return 1;
+    }
+    writeStore(output, argv[1], name, bucketCount, displacements, slots);
+    if (fclose(output)!=0){
+        fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%u keys, %u buckets\n", keyCount, bucketCount);
+    return 0;
+}
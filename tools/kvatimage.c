@@ -0,0 +1,123 @@
+/*
+ * kvatimage.c
+ * KVAT - Key Value Address Table
+ *
+ * Host tool for factory programming. Builds a complete EEPROM image from a key/value manifest,
+ * using the same kvat.c as the device on top of a RAM-backed EEPROM (tools/host).
+ * The image is formatted, with chains laid out contiguously and the table packed in manifest order.
+ * Once programmed at EEPROM address 0, KVATInit accepts it as is on first boot.
+ *
+ * Usage: kvatimage <manifest> <image.bin>
+ * Manifest format: see manifest.h
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "eeprom_host.h"
+#include "manifest.h"
+
+/**
+ * Saves a manifest line into the store.
+ *
+ * @param      line          Line read from the manifest (modified).
+ * @param      lineNumber    For error messages.
+ * @param[out] isKey         Indicates if the line held a key.
+ *
+ * @return true on success (or if there was nothing to save).
+ */
+static bool saveLine(char* line, unsigned lineNumber, bool* isKey){
+    ManifestLine parsed;
+    if (!parseManifestLine(line, lineNumber, &parsed)){return false;}
+
+    *isKey = parsed.type!=ManifestType_none;
+
+    KVATException exception = KVATException_none;
+    if (parsed.type==ManifestType_raw){
+        exception = KVATSaveValue(parsed.key, parsed.value, parsed.size);
+    }else if (parsed.type==ManifestType_counter){
+        exception = KVATCounterAdd(parsed.key, parsed.count, NULL);
+    }
+
+    if (exception==KVATException_none){return true;}
+
+    fprintf(stderr, "line %u: could not save '%s' (KVATException %d)\n", lineNumber, parsed.key, exception);
+    return false;
+}
+
+int main(int argc, char** argv){
+    if (argc!=3){
+        fprintf(stderr, "usage: %s <manifest> <image.bin>\n", argv[0]);
+        return 2;
+    }
+
+    // Image is written as it sits in memory. TM4C is little-endian.
+    uint16_t endianCheck = 1;
+    if (*(uint8_t*)&endianCheck!=1){
+        fprintf(stderr, "host must be little-endian\n");
+        return 1;
+    }
+
+    FILE* manifest = fopen(argv[1], "r");
+    if (manifest==NULL){
+        perror(argv[1]);
+        return 1;
+    }
+
+    // Formats the (erased) RAM EEPROM, as on a fresh board
+    KVATException initException = KVATInit();
+    if (initException!=KVATException_none){
+        fprintf(stderr, "init failed (KVATException %d)\n", initException);
+        fclose(manifest);
+        return 1;
+    }
+
+    char line[LINEMAXLEN];
+    unsigned lineNumber = 0;
+    KVATSize keyCount = 0;
+    bool isValid = true;
+
+    while (isValid && fgets(line, LINEMAXLEN, manifest)){
+        lineNumber++;
+        if (strchr(line, '\n')==NULL && !feof(manifest)){
+            fprintf(stderr, "line %u: too long\n", lineNumber);
+            isValid = false;
+            break;
+        }
+
+        KVATSize previousCount = keyCount;
+        bool isKey = false;
+        isValid = saveLine(line, lineNumber, &isKey);
+        KVATCount(&keyCount);
+
+        // Same key twice would silently overwrite
+        if (isValid && isKey && keyCount==previousCount){
+            fprintf(stderr, "line %u: duplicate key\n", lineNumber);
+            isValid = false;
+        }
+    }
+    fclose(manifest);
+
+    if (!isValid){return 1;}
+
+    FILE* image = fopen(argv[2], "wb");
+    if (image==NULL){
+        perror(argv[2]);
+        return 1;
+    }
+
+    bool didWrite = fwrite(hostEEPROM, 1, HOSTEEPROMSIZE, image)==HOSTEEPROMSIZE;
+    didWrite = fclose(image)==0 && didWrite;
+    if (!didWrite){
+        fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%u keys, %u byte image\n", (unsigned)keyCount, HOSTEEPROMSIZE);
+    return 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * kvatkeys.c
+ * KVAT - Key Value Address Table
+ *
+ * Host tool that generates a C header of keys known at build time, each a KVATKey with its length and
+ * hash (kvatFrozenHash(key, 0)) already computed. Passed to the ...WithKey calls, they are not measured,
+ * and hashed lookups (frozen store, log store) start from the hash. C++ has the same at compile time (kvat.hpp).
+ *
+ * Usage: kvatkeys <keys> <output.h>
+ * Keys: one key per line. Blank lines and lines starting with # are ignored. Manifest lines (key=value,
+ * see manifest.h) are accepted too, only the key is used, so a manifest of defaults can list its own keys.
+ * Each key is named by its characters, with anything but letters and digits as '_':
+ *     boot/count    ->    KVATKEYREF(boot_count), a const KVATKey* (the constant kvatKey_boot_count)
+ * Fails on a repeated key, two keys with the same name, or two keys with the same hash.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat_frozen.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "manifest.h"
+
+// Key read from the list
+typedef struct NamedKey{
+    char* key;
+    char* name;         // C identifier part (kvatKey_<name>)
+    uint32_t hash;
+    unsigned lineNumber;
+}NamedKey;
+
+static NamedKey* keys = NULL;
+static uint32_t keyCount = 0;
+
+/**
+ * Makes the identifier part for a key.
+ *
+ * @return Allocated name, or NULL on heap failure.
+ */
+static char* nameKey(const char* key){
+    char* name = malloc(strlen(key)+1);
+    if (name==NULL){return NULL;}
+
+    for (size_t charI = 0; key[charI]; charI++){
+        name[charI] = isalnum((unsigned char)key[charI]) ? key[charI] : '_';
+    }
+    name[strlen(key)] = '\0';
+
+    return name;
+}
+
+/**
+ * Checks a new key against the ones read before it. Errors are printed to stderr.
+ *
+ * @return true if it clashes with none.
+ */
+static bool checkKey(const NamedKey* key){
+    for (uint32_t keyI = 0; keyI<keyCount; keyI++){
+        const NamedKey* other = &keys[keyI];
+
+        if (strcmp(other->key, key->key)==0){
+            fprintf(stderr, "line %u: duplicate key (line %u)\n", key->lineNumber, other->lineNumber);
+            return false;
+        }
+        if (strcmp(other->name, key->name)==0){
+            fprintf(stderr, "line %u: key is named %s, as the key on line %u\n", key->lineNumber, key->name, other->lineNumber);
+            return false;
+        }
+        if (other->hash==key->hash){
+            fprintf(stderr, "line %u: key hash collides with the key on line %u\n", key->lineNumber, other->lineNumber);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Reads every key of the list into keys.
+ *
+ * @return true on success.
+ */
+static bool readKeys(FILE* list){
+    char line[LINEMAXLEN];
+    unsigned lineNumber = 0;
+    uint32_t keyCapacity = 0;
+
+    while (fgets(line, LINEMAXLEN, list)){
+        lineNumber++;
+        if (strchr(line, '\n')==NULL && !feof(list)){
+            fprintf(stderr, "line %u: too long\n", lineNumber);
+            return false;
+        }
+
+        const char* key;
+        if (strchr(line, '=')!=NULL){
+            ManifestLine parsed;
+            if (!parseManifestLine(line, lineNumber, &parsed)){return false;}
+            if (parsed.type==ManifestType_none){continue;}
+            key = parsed.key;
+        }else{
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0]=='\0' || line[0]=='#'){continue;}
+            key = line;
+        }
+
+        if (keyCount==keyCapacity){
+            keyCapacity = keyCapacity ? keyCapacity*2 : 32;
+            NamedKey* grown = realloc(keys, sizeof(NamedKey)*keyCapacity);
+            if (grown==NULL){return false;}
+            keys = grown;
+        }
+
+        NamedKey* namedKey = &keys[keyCount];
+        namedKey->key = malloc(strlen(key)+1);
+        namedKey->name = nameKey(key);
+        if (namedKey->key==NULL || namedKey->name==NULL){return false;}
+        strcpy(namedKey->key, key);
+        namedKey->hash = kvatFrozenHash(key, 0);
+        namedKey->lineNumber = lineNumber;
+
+        if (!checkKey(namedKey)){return false;}
+        keyCount++;
+    }
+
+    return true;
+}
+
+/**
+ * Writes a string as a C literal.
+ */
+static void writeStringLiteral(FILE* output, const char* text){
+    fputc('"', output);
+    for (; *text; text++){
+        unsigned char c = *text;
+        if (c=='"' || c=='\\'){
+            fprintf(output, "\\%c", c);
+        }else if (c<0x20 || c>=0x7F){
+            fprintf(output, "\\%03o", c);
+        }else{
+            fputc(c, output);
+        }
+    }
+    fputc('"', output);
+}
+
+/**
+ * Writes the keys as a C header. The include guard is made from the output file name.
+ */
+static void writeKeys(FILE* output, const char* listName, const char* outputName){
+    const char* baseName = strrchr(outputName, '/') ? strrchr(outputName, '/')+1 : outputName;
+    char* guard = nameKey(baseName);
+    for (char* guardChar = guard; guard && *guardChar; guardChar++){
+        *guardChar = toupper((unsigned char)*guardChar);
+    }
+
+    fprintf(output, "/*\n * Keys generated by kvatkeys from %s. Do not edit.\n */\n\n", listName);
+    fprintf(output, "#ifndef %s_\n#define %s_\n\n", guard ? guard : "KVATKEYS_H", guard ? guard : "KVATKEYS_H");
+    fprintf(output, "#include \"kvat/kvat.h\"\n\n");
+    fprintf(output, "// Key by name, for the ...WithKey calls, in C and C++ (KVATKEY(\"...\") in kvat.hpp takes a literal instead)\n");
+    fprintf(output, "#ifndef KVATKEYREF\n#define KVATKEYREF(name) (&kvatKey_##name)\n#endif\n\n");
+
+    for (uint32_t keyI = 0; keyI<keyCount; keyI++){
+        fprintf(output, "static const KVATKey kvatKey_%s = {", keys[keyI].name);
+        writeStringLiteral(output, keys[keyI].key);
+        fprintf(output, ", %u, 0x%08Xu};\n", (unsigned)strlen(keys[keyI].key), keys[keyI].hash);
+    }
+
+    fprintf(output, "\n#endif\n");
+    free(guard);
+}
+
+int main(int argc, char** argv){
+    if (argc!=3){
+        fprintf(stderr, "usage: %s <keys> <output.h>\n", argv[0]);
+        return 2;
+    }
+
+    FILE* list = fopen(argv[1], "r");
+    if (list==NULL){
+        perror(argv[1]);
+        return 1;
+    }
+    bool didRead = readKeys(list);
+    fclose(list);
+    if (!didRead){return 1;}
+
+    FILE* output = fopen(argv[2], "w");
+    if (output==NULL){
+        perror(argv[2]);
+        return 1;
+    }
+    writeKeys(output, argv[1], argv[2]);
+    if (fclose(output)!=0){
+        fprintf(stderr, "could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%u keys\n", keyCount);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * manifest.c
+ * KVAT - Key Value Address Table
+ *
+ * Key/value manifest parsing for the host tools.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "manifest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+/**
+ * Converts a hex digit into its value.
+ *
+ * @return Value of the digit, or -1 if not a hex digit.
+ */
+static int hexValue(char c){
+    if (c>='0' && c<='9'){return c-'0';}
+    if (c>='a' && c<='f'){return c-'a'+10;}
+    if (c>='A' && c<='F'){return c-'A'+10;}
+    return -1;
+}
+
+/**
+ * Decodes a quoted string with escapes. Output includes the terminator.
+ *
+ * @param      text          Text starting at the opening quote.
+ * @param[out] value         Buffer for the decoded bytes (at least as long as text).
+ * @param[out] size          Number of bytes decoded.
+ *
+ * @return true on success.
+ */
+static bool decodeString(const char* text, char* value, KVATSize* size){
+    KVATSize length = 0;
+    text++;     // Opening quote
+
+    while (*text && *text!='"'){
+        char c = *text++;
+        if (c=='\\'){
+            c = *text++;
+            switch (c){
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case '0': c = '\0'; break;
+                case '\\': case '"': break;
+                case 'x':{
+                    int high = hexValue(text[0]);
+                    int low = high<0 ? -1 : hexValue(text[1]);
+                    if (low<0){return false;}
+                    c = (char)(high<<4 | low);
+                    text += 2;
+                    break;
+                }
+                default: return false;
+            }
+        }
+        value[length++] = c;
+    }
+
+    // Must close, with nothing after
+    if (*text!='"' || text[1]!='\0'){return false;}
+
+    value[length++] = '\0';
+    *size = length;
+    return true;
+}
+
+/**
+ * Decodes hex digits into bytes.
+ *
+ * @return true on success.
+ */
+static bool decodeHex(const char* text, char* value, KVATSize* size){
+    KVATSize length = 0;
+    while (text[0] && text[1]){
+        int high = hexValue(text[0]);
+        int low = hexValue(text[1]);
+        if (high<0 || low<0){return false;}
+        value[length++] = (char)(high<<4 | low);
+        text += 2;
+    }
+    if (*text || length==0){return false;}
+
+    *size = length;
+    return true;
+}
+
+/**
+ * Removes whitespace at both ends of a string, in place.
+ *
+ * @return Trimmed string (within the original).
+ */
+static char* trim(char* text){
+    while (isspace((unsigned char)*text)){text++;}
+
+    char* end = text+strlen(text);
+    while (end>text && isspace((unsigned char)end[-1])){end--;}
+    *end = '\0';
+
+    return text;
+}
+
+bool parseManifestLine(char* line, unsigned lineNumber, ManifestLine* parsed){
+    parsed->type = ManifestType_none;
+
+    line = trim(line);
+    if (*line=='\0' || *line=='#'){return true;}
+
+    char* separator = strchr(line, '=');
+    if (separator==NULL){
+        fprintf(stderr, "line %u: expected key=value\n", lineNumber);
+        return false;
+    }
+    *separator = '\0';
+    char* key = trim(line);
+    char* text = trim(separator+1);
+    if (*key=='\0'){
+        fprintf(stderr, "line %u: empty key\n", lineNumber);
+        return false;
+    }
+    parsed->key = key;
+
+    if (*text=='"'){
+        if (!decodeString(text, parsed->value, &parsed->size)){
+            fprintf(stderr, "line %u: invalid string\n", lineNumber);
+            return false;
+        }
+        parsed->type = ManifestType_raw;
+    }else if (strncmp(text, "hex:", 4)==0){
+        if (!decodeHex(text+4, parsed->value, &parsed->size)){
+            fprintf(stderr, "line %u: invalid hex\n", lineNumber);
+            return false;
+        }
+        parsed->type = ManifestType_raw;
+    }else if (strncmp(text, "counter:", 8)==0){
+        char* end;
+        unsigned long count = strtoul(text+8, &end, 0);
+        if (*end || end==text+8 || count>UINT32_MAX){
+            fprintf(stderr, "line %u: invalid counter\n", lineNumber);
+            return false;
+        }
+        parsed->count = (KVATCounter)count;
+        parsed->type = ManifestType_counter;
+    }else{
+        fprintf(stderr, "line %u: value must be \"text\", hex: or counter:\n", lineNumber);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+ * manifest.h
+ * KVAT - Key Value Address Table
+ *
+ * Key/value manifest parsing for the host tools.
+ *
+ * Manifest: one key per line, as key=value. Blank lines and lines starting with # are ignored.
+ *     key="text"        String, with its terminator (as KVATSaveString). Escapes: \\ \" \n \r \t \0 \xHH
+ *     key=hex:00A1FF    Raw bytes
+ *     key=counter:42    Counter (see KVATCounterOpen)
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#ifndef MANIFEST_H_
+#define MANIFEST_H_
+
+#include "kvat/kvat.h"
+
+#define LINEMAXLEN 1024 // Longest manifest line supported
+
+typedef enum ManifestType{
+    ManifestType_none,      // Blank line or comment
+    ManifestType_raw,       // Bytes in value (strings included)
+    ManifestType_counter    // Count in count
+}ManifestType;
+
+typedef struct ManifestLine{
+    ManifestType type;
+    const char* key;        // Within the line parsed
+    char value[LINEMAXLEN];
+    KVATSize size;
+    KVATCounter count;
+}ManifestLine;
+
+/**
+ * Parses a manifest line. Errors are printed to stderr.
+ *
+ * @param      line          Line read from the manifest (modified, key points into it).
+ * @param      lineNumber    For error messages.
+ * @param[out] parsed        Contents of the line.
+ *
+ * @return true on success.
+ */
+bool parseManifestLine(char* line, unsigned lineNumber, ManifestLine* parsed);
+
+#endif /* MANIFEST_H_ */
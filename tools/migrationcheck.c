@@ -0,0 +1,232 @@
+/*
+ * migrationcheck.c
+ * KVAT - Key Value Address Table
+ *
+ * Host check for store migration (MIGRATION, kvat.c). Loads an image in an older layout, cuts power at every
+ * program of the migration in turn, and checks that the next KVATInit resumes it with every manifest key intact.
+ * Older images are built by kvatimage compiled with the older layout (see Makefile, check).
+ *
+ * Usage: migrationcheck <manifest> <image.bin>
+ * Manifest format: see manifest.h. It must be the one the image was built from.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#define _POSIX_C_SOURCE 200809L // fork, so every cut runs on a store that never started
+
+#include "kvat/kvat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "eeprom_host.h"
+#include "manifest.h"
+
+#define CUTMAX 100000   // Most programs a migration is expected to take
+
+// Child exit codes
+#define RUNVALID 0      // Interrupted, resumed and checked
+#define RUNFAILED 1     // Resumed store doesn't hold the manifest
+#define RUNFINISHED 3   // Init finished before the cut
+
+static long programsLeft = -1;  // Programs that still reach the memory. -1 for no cut.
+
+static bool cutInit(void* context, uint32_t* size){
+    *size = HOSTEEPROMSIZE;
+    return true;
+}
+
+static bool cutRead(void* context, uint32_t address, void* data, uint32_t size){
+    memcpy(data, hostEEPROM+address, size);
+    return true;
+}
+
+static bool cutProgram(void* context, uint32_t address, const void* data, uint32_t size){
+    if (programsLeft==0){return false;}     // Power is gone: nothing more is programmed
+    if (programsLeft>0){programsLeft--;}
+
+    memcpy(hostEEPROM+address, data, size);
+    return true;
+}
+
+static const KVATBackend cutBackend = {&cutInit, &cutRead, &cutProgram, NULL};
+
+/**
+ * Checks one manifest line against the store.
+ *
+ * @param      line          Line read from the manifest (modified).
+ * @param      lineNumber    For error messages.
+ * @param[out] isKey         Indicates if the line held a key.
+ *
+ * @return true if the key holds the value in the line (or if there was nothing to check).
+ */
+static bool checkLine(char* line, unsigned lineNumber, bool* isKey){
+    ManifestLine parsed;
+    if (!parseManifestLine(line, lineNumber, &parsed)){return false;}
+
+    *isKey = parsed.type!=ManifestType_none;
+
+    if (parsed.type==ManifestType_raw){
+        void* value = NULL;
+        KVATSize size = 0;
+        KVATException exception = KVATRetrieveValue(parsed.key, NULL, 0, &value, &size);
+        bool isValid = exception==KVATException_none && size==parsed.size && memcmp(value, parsed.value, size)==0;
+        free(value);
+        if (!isValid){
+            fprintf(stderr, "line %u: '%s' does not match (KVATException %d)\n", lineNumber, parsed.key, exception);
+        }
+        return isValid;
+    }
+
+    if (parsed.type==ManifestType_counter){
+        KVATCounter count = 0;
+        KVATException exception = KVATCounterGet(parsed.key, &count);
+        if (exception!=KVATException_none || count!=parsed.count){
+            fprintf(stderr, "line %u: counter '%s' does not match (KVATException %d)\n", lineNumber, parsed.key, exception);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Checks every manifest key, that nothing else is in the store, and that it still takes a save.
+ *
+ * @return true if the store holds the manifest.
+ */
+static bool checkStore(const char* manifestPath){
+    FILE* manifest = fopen(manifestPath, "r");
+    if (manifest==NULL){
+        perror(manifestPath);
+        return false;
+    }
+
+    char line[LINEMAXLEN];
+    unsigned lineNumber = 0;
+    KVATSize keyCount = 0;
+    bool isValid = true;
+
+    while (isValid && fgets(line, LINEMAXLEN, manifest)){
+        lineNumber++;
+        bool isKey = false;
+        isValid = checkLine(line, lineNumber, &isKey);
+        if (isKey){keyCount++;}
+    }
+    fclose(manifest);
+    if (!isValid){return false;}
+
+    KVATSize storeCount = 0;
+    KVATCount(&storeCount);
+    if (storeCount!=keyCount){
+        fprintf(stderr, "store holds %u keys, manifest %u\n", (unsigned)storeCount, (unsigned)keyCount);
+        return false;
+    }
+
+    char read[8];
+    if (KVATSaveString("migrationcheck", "saved")!=KVATException_none || KVATRetrieveStringByBuffer("migrationcheck", read, sizeof(read))!=KVATException_none || strcmp(read, "saved")!=0){
+        fprintf(stderr, "store doesn't take a save\n");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Starts the store on the image, with power cut after a number of programs, then starts it again.
+ *
+ * @param      cut    Programs that reach the memory. -1 for no cut.
+ *
+ * @return Child exit code (RUNVALID, RUNFAILED or RUNFINISHED).
+ */
+static int runCut(const char* manifestPath, const uint8_t* image, long cut){
+    memcpy(hostEEPROM, image, HOSTEEPROMSIZE);
+
+    programsLeft = cut;
+    KVATSetBackend(&cutBackend);
+    KVATException exception = KVATInit();
+    programsLeft = -1;
+    if (exception==KVATException_none){
+        if (!checkStore(manifestPath)){return RUNFAILED;}
+        return cut<0 ? RUNVALID : RUNFINISHED;
+    }
+    if (cut<0){
+        fprintf(stderr, "init failed (KVATException %d)\n", exception);
+        return RUNFAILED;
+    }
+
+    // Power is back
+    exception = KVATInit();
+    if (exception!=KVATException_none){
+        fprintf(stderr, "init after cut failed (KVATException %d)\n", exception);
+        return RUNFAILED;
+    }
+
+    return checkStore(manifestPath) ? RUNVALID : RUNFAILED;
+}
+
+/**
+ * Runs a cut in a child process, so the store starts from nothing every time.
+ *
+ * @return Child exit code. RUNFAILED if it didn't exit.
+ */
+static int forkCut(const char* manifestPath, const uint8_t* image, long cut){
+    fflush(stdout);
+    pid_t child = fork();
+    if (child<0){
+        perror("fork");
+        return RUNFAILED;
+    }
+    if (child==0){
+        _exit(runCut(manifestPath, image, cut));
+    }
+
+    int status;
+    if (waitpid(child, &status, 0)!=child || !WIFEXITED(status)){return RUNFAILED;}
+    return WEXITSTATUS(status);
+}
+
+int main(int argc, char** argv){
+    if (argc!=3){
+        fprintf(stderr, "usage: %s <manifest> <image.bin>\n", argv[0]);
+        return 2;
+    }
+
+    static uint8_t image[HOSTEEPROMSIZE];
+    FILE* imageFile = fopen(argv[2], "rb");
+    if (imageFile==NULL){
+        perror(argv[2]);
+        return 1;
+    }
+    bool didRead = fread(image, 1, HOSTEEPROMSIZE, imageFile)==HOSTEEPROMSIZE;
+    fclose(imageFile);
+    if (!didRead){
+        fprintf(stderr, "%s is not a %u byte image\n", argv[2], HOSTEEPROMSIZE);
+        return 1;
+    }
+
+    // Uninterrupted first: the image must migrate at all
+    if (forkCut(argv[1], image, -1)!=RUNVALID){
+        fprintf(stderr, "%s: migration failed\n", argv[2]);
+        return 1;
+    }
+
+    for (long cut = 0; cut<CUTMAX; cut++){
+        int result = forkCut(argv[1], image, cut);
+        if (result==RUNFINISHED){
+            printf("%s: migrated, and resumed after a cut at each of %ld programs\n", argv[2], cut);
+            return 0;
+        }
+        if (result!=RUNVALID){
+            fprintf(stderr, "%s: power cut after %ld programs leaves a broken store\n", argv[2], cut);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%s: migration takes over %d programs\n", argv[2], CUTMAX);
+    return 1;
+}
@@ -0,0 +1,284 @@
+/*
+ * resizecheck.c
+ * KVAT - Key Value Address Table
+ *
+ * Host check for KVATResize. Builds a store, cuts power at every program of a resize in turn, and checks that
+ * after the next KVATInit every key is intact, the same resize can be called again, and every key deleted.
+ * Runs a shrink (tombstones to reclaim) and a grow whose values don't fit in the pages the store starts with.
+ *
+ * Usage: resizecheck
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#define _POSIX_C_SOURCE 200809L // fork, so every cut runs on a store that never started
+
+#include "kvat/kvat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "eeprom_host.h"
+
+#define CUTMAX 100000   // Most programs a resize is expected to take
+#define KEYMAXLEN 16
+#define VALUEMAXLEN 32
+#define COUNTERKEY "count"
+#define COUNTERVALUE 41
+
+// Child exit codes
+#define RUNVALID 0      // Interrupted, resumed and checked
+#define RUNFAILED 1     // Resumed store doesn't hold the keys
+#define RUNFINISHED 3   // Resize finished before the cut
+
+// Store built before the resize: keys saved in order, the first ones deleted again (tombstones)
+typedef struct ResizeCase{
+    const char* name;
+    unsigned savedCount;
+    unsigned deletedCount;
+    KVATSize valueLength;   // Length of every value (without terminator)
+    KVATSize pageCount;     // Page count to resize to
+}ResizeCase;
+
+static const ResizeCase resizeCases[] = {
+    {"shrink to 50", 63, 43, 3, 50},
+    {"grow to 200", 28, 0, 20, 200},
+};
+
+static long programsLeft = -1;  // Programs that still reach the memory. -1 for no cut.
+
+static bool cutInit(void* context, uint32_t* size){
+    *size = HOSTEEPROMSIZE;
+    return true;
+}
+
+static bool cutRead(void* context, uint32_t address, void* data, uint32_t size){
+    memcpy(data, hostEEPROM+address, size);
+    return true;
+}
+
+static bool cutProgram(void* context, uint32_t address, const void* data, uint32_t size){
+    if (programsLeft==0){return false;}     // Power is gone: nothing more is programmed
+    if (programsLeft>0){programsLeft--;}
+
+    memcpy(hostEEPROM+address, data, size);
+    return true;
+}
+
+static const KVATBackend cutBackend = {&cutInit, &cutRead, &cutProgram, NULL};
+
+/**
+ * Writes the key and value saved as number keyN.
+ */
+static void makeKeyValue(const ResizeCase* resizeCase, unsigned keyN, char* key, char* value){
+    snprintf(key, KEYMAXLEN, "k%02u", keyN);
+    for (KVATSize charI = 0; charI<resizeCase->valueLength; charI++){
+        value[charI] = 'a'+(keyN+charI)%26;
+    }
+    value[resizeCase->valueLength] = '\0';
+}
+
+/**
+ * Builds the store of a case on a blank memory.
+ *
+ * @return true if every save and delete went through.
+ */
+static bool buildStore(const ResizeCase* resizeCase){
+    memset(hostEEPROM, 0xFF, HOSTEEPROMSIZE);
+    if (KVATInit()!=KVATException_none){return false;}
+
+    char key[KEYMAXLEN];
+    char value[VALUEMAXLEN];
+    for (unsigned keyN = 0; keyN<resizeCase->savedCount; keyN++){
+        makeKeyValue(resizeCase, keyN, key, value);
+        if (KVATSaveString(key, value)!=KVATException_none){return false;}
+    }
+    for (unsigned keyN = 0; keyN<resizeCase->deletedCount; keyN++){
+        makeKeyValue(resizeCase, keyN, key, value);
+        if (KVATDeleteValue(key)!=KVATException_none){return false;}
+    }
+
+    KVATCounter count;
+    if (KVATCounterAdd(COUNTERKEY, COUNTERVALUE, &count)!=KVATException_none){return false;}
+
+    return KVATDeinit()==KVATException_none;
+}
+
+/**
+ * Checks every key of the case against the store, and that nothing else is in it.
+ *
+ * @return true if the store holds the keys.
+ */
+static bool checkKeys(const ResizeCase* resizeCase){
+    char key[KEYMAXLEN];
+    char value[VALUEMAXLEN];
+    char read[VALUEMAXLEN];
+
+    for (unsigned keyN = 0; keyN<resizeCase->savedCount; keyN++){
+        makeKeyValue(resizeCase, keyN, key, value);
+        KVATException exception = KVATRetrieveStringByBuffer(key, read, VALUEMAXLEN);
+
+        bool isDeleted = keyN<resizeCase->deletedCount;
+        if (isDeleted ? exception!=KVATException_notFound : (exception!=KVATException_none || strcmp(read, value)!=0)){
+            fprintf(stderr, "'%s' does not match (KVATException %d)\n", key, exception);
+            return false;
+        }
+    }
+
+    KVATCounter count = 0;
+    KVATException exception = KVATCounterGet(COUNTERKEY, &count);
+    if (exception!=KVATException_none || count!=COUNTERVALUE){
+        fprintf(stderr, "counter '%s' does not match (KVATException %d)\n", COUNTERKEY, exception);
+        return false;
+    }
+
+    KVATSize storeCount = 0;
+    KVATCount(&storeCount);
+    if (storeCount!=resizeCase->savedCount-resizeCase->deletedCount+1){
+        fprintf(stderr, "store holds %u keys, expected %u\n", (unsigned)storeCount, resizeCase->savedCount-resizeCase->deletedCount+1);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Checks the store after a resize: its keys, the same resize called again, and that every key can be deleted.
+ *
+ * @return true if the store passes.
+ */
+static bool checkStore(const ResizeCase* resizeCase){
+    if (!checkKeys(resizeCase)){return false;}
+
+    KVATException exception = KVATResize(resizeCase->pageCount);
+    if (exception!=KVATException_none){
+        fprintf(stderr, "resize again failed (KVATException %d)\n", exception);
+        return false;
+    }
+    if (!checkKeys(resizeCase)){return false;}
+
+    KVATSize deletedCount = 0;
+    KVATSize storeCount = 0;
+    exception = KVATDeletePrefix("", &deletedCount);
+    KVATCount(&storeCount);
+    if (exception!=KVATException_none || storeCount!=0){
+        fprintf(stderr, "delete left %u keys (KVATException %d)\n", (unsigned)storeCount, exception);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Starts the store on the image, resizes it with power cut after a number of programs, then starts it again.
+ *
+ * @param      cut    Programs that reach the memory. -1 for no cut.
+ *
+ * @return Child exit code (RUNVALID, RUNFAILED or RUNFINISHED).
+ */
+static int runCut(const ResizeCase* resizeCase, const uint8_t* image, long cut){
+    memcpy(hostEEPROM, image, HOSTEEPROMSIZE);
+
+    KVATSetBackend(&cutBackend);
+    KVATException exception = KVATInit();
+    if (exception!=KVATException_none){
+        fprintf(stderr, "init failed (KVATException %d)\n", exception);
+        return RUNFAILED;
+    }
+
+    programsLeft = cut;
+    exception = KVATResize(resizeCase->pageCount);
+    programsLeft = -1;
+    if (exception==KVATException_none){
+        if (!checkStore(resizeCase)){return RUNFAILED;}
+        return cut<0 ? RUNVALID : RUNFINISHED;
+    }
+    if (cut<0){
+        fprintf(stderr, "resize failed (KVATException %d)\n", exception);
+        return RUNFAILED;
+    }
+
+    // Power is back (a failed resize may have stopped the store already)
+    KVATDeinit();
+    exception = KVATInit();
+    if (exception!=KVATException_none){
+        fprintf(stderr, "init after cut failed (KVATException %d)\n", exception);
+        return RUNFAILED;
+    }
+
+    return checkStore(resizeCase) ? RUNVALID : RUNFAILED;
+}
+
+/**
+ * Runs a cut in a child process, so the store starts from nothing every time.
+ *
+ * @return Child exit code. RUNFAILED if it didn't exit.
+ */
+static int forkCut(const ResizeCase* resizeCase, const uint8_t* image, long cut){
+    fflush(stdout);
+    pid_t child = fork();
+    if (child<0){
+        perror("fork");
+        return RUNFAILED;
+    }
+    if (child==0){
+        _exit(runCut(resizeCase, image, cut));
+    }
+
+    int status;
+    if (waitpid(child, &status, 0)!=child || !WIFEXITED(status)){return RUNFAILED;}
+    return WEXITSTATUS(status);
+}
+
+/**
+ * Builds the store of a case, then resizes it with a cut at every program in turn.
+ *
+ * @return true if the store was intact after every cut.
+ */
+static bool checkCase(const ResizeCase* resizeCase){
+    static uint8_t image[HOSTEEPROMSIZE];
+    if (!buildStore(resizeCase)){
+        fprintf(stderr, "%s: store could not be built\n", resizeCase->name);
+        return false;
+    }
+    memcpy(image, hostEEPROM, HOSTEEPROMSIZE);
+
+    // Uninterrupted first: the store must resize at all
+    if (forkCut(resizeCase, image, -1)!=RUNVALID){
+        fprintf(stderr, "%s: resize failed\n", resizeCase->name);
+        return false;
+    }
+
+    for (long cut = 0; cut<CUTMAX; cut++){
+        int result = forkCut(resizeCase, image, cut);
+        if (result==RUNFINISHED){
+            printf("%s: resized, and resumed after a cut at each of %ld programs\n", resizeCase->name, cut);
+            return true;
+        }
+        if (result!=RUNVALID){
+            fprintf(stderr, "%s: power cut after %ld programs leaves a broken store\n", resizeCase->name, cut);
+            return false;
+        }
+    }
+
+    fprintf(stderr, "%s: resize takes over %d programs\n", resizeCase->name, CUTMAX);
+    return false;
+}
+
+int main(int argc, char** argv){
+    if (argc!=1){
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    bool isValid = true;
+    for (size_t caseI = 0; caseI<sizeof(resizeCases)/sizeof(resizeCases[0]); caseI++){
+        isValid = checkCase(&resizeCases[caseI]) && isValid;
+    }
+
+    return isValid ? 0 : 1;
+}
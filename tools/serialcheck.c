@@ -0,0 +1,105 @@
+/*
+ * serialcheck.c
+ * KVAT - Key Value Address Table
+ *
+ * Host check for the serial memory backend (kvat_serial.c). Runs the store on a simulated serial memory
+ * (tools/host/serial_host.c), verifies every value read back, and reports bus transactions.
+ *
+ * Usage: serialcheck [writePageSize]
+ * With no write page size the memory behaves as FRAM. Give one (e.g. 32) to simulate a serial EEPROM.
+ *
+ * Author: repixen
+ * Copyright (c) 2020-2021, repixen. All rights reserved.
+ */
+
+#include "kvat/kvat.h"
+#include "kvat/kvat_serial.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "serial_host.h"
+
+#define CHECKKEYS 16        // Keys saved (the store holds PAGECOUNT pages whatever the memory size)
+#define CHECKVALUEMAX 48    // Largest value saved (bytes)
+
+static KVATSerialMemory memory = {.transfer = &hostSerialTransfer, .size = HOSTSERIALSIZE, .addressSize = 2};
+
+/**
+ * Fills a value that can be told apart from the others.
+ */
+static KVATSize makeValue(unsigned keyI, unsigned round, unsigned char* value){
+    KVATSize size = 1 + (keyI*37 + round*11) % CHECKVALUEMAX;
+    for (KVATSize byteI = 0; byteI<size; byteI++){
+        value[byteI] = keyI*7 + round*3 + byteI;
+    }
+    return size;
+}
+
+/**
+ * Saves every key, then reads every key back and compares.
+ *
+ * @return true if every value matched.
+ */
+static bool runRound(unsigned round){
+    char key[16];
+    unsigned char value[CHECKVALUEMAX];
+    unsigned char read[CHECKVALUEMAX];
+
+    uint32_t transactions = hostSerialTransactions;
+    for (unsigned keyI = 0; keyI<CHECKKEYS; keyI++){
+        sprintf(key, "check/%u", keyI);
+        KVATSize size = makeValue(keyI, round, value);
+        KVATException exception = KVATSaveValue(key, value, size);
+        if (exception!=KVATException_none){
+            fprintf(stderr, "round %u: could not save '%s' (KVATException %d)\n", round, key, exception);
+            return false;
+        }
+    }
+    uint32_t saveTransactions = hostSerialTransactions-transactions;
+
+    transactions = hostSerialTransactions;
+    for (unsigned keyI = 0; keyI<CHECKKEYS; keyI++){
+        sprintf(key, "check/%u", keyI);
+        KVATSize size = makeValue(keyI, round, value);
+        KVATSize readSize = 0;
+        KVATException exception = KVATRetrieveValueByBuffer(key, read, CHECKVALUEMAX, &readSize);
+        if (exception!=KVATException_none || readSize!=size || memcmp(read, value, size)!=0){
+            fprintf(stderr, "round %u: '%s' does not match (KVATException %d)\n", round, key, exception);
+            return false;
+        }
+    }
+    uint32_t retrieveTransactions = hostSerialTransactions-transactions;
+
+    printf("round %u: %u transactions per save, %u per retrieve\n", round, (unsigned)(saveTransactions/CHECKKEYS), (unsigned)(retrieveTransactions/CHECKKEYS));
+    return true;
+}
+
+int main(int argc, char** argv){
+    if (argc>2){
+        fprintf(stderr, "usage: %s [writePageSize]\n", argv[0]);
+        return 2;
+    }
+    if (argc==2){
+        hostSerialWritePageSize = strtoul(argv[1], NULL, 0);
+        memory.writePageSize = hostSerialWritePageSize;
+    }
+
+    KVATBackend backend;
+    KVATSerialBackend(&memory, &backend);
+    KVATSetBackend(&backend);
+
+    KVATException initException = KVATInit();
+    if (initException!=KVATException_none){
+        fprintf(stderr, "init failed (KVATException %d)\n", initException);
+        return 1;
+    }
+
+    // Later rounds overwrite every value, so chains are no longer laid out in order
+    for (unsigned round = 0; round<3; round++){
+        if (!runRound(round)){return 1;}
+    }
+
+    printf("%s: %u transactions, %u bus bytes\n", hostSerialWritePageSize ? "serial EEPROM" : "FRAM", (unsigned)hostSerialTransactions, (unsigned)hostSerialBusBytes);
+    return 0;
+}